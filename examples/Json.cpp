@@ -9,40 +9,50 @@ int main(int argc, char* argv[]) {
   QFileInfo fileInfo(path);
   if (!fileInfo.exists()) return EXIT_FAILURE;
 
-  QFile file(fileInfo.absoluteFilePath());
-  if (!file.open(QFile::ReadOnly | QFile::Text)) return EXIT_FAILURE;
-
-  QJsonParseError error;
-  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
-  if (error.error != QJsonParseError::NoError) return EXIT_FAILURE;
-  file.close();
-
   QTreeView tree;
-  QStandardItemModel* model = new QStandardItemModel;
+  // Rows are created only when expanded, huge documents open immediately.
+  KtUtils::Json::Model* model = new KtUtils::Json::Model(&tree);
   tree.setModel(model);
-  QList<QStandardItem*> row = KtUtils::Json::toStandardItem(
-      doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object()),
-      fileInfo.fileName());
-  model->appendRow(row);
-  // Object only return 1 item, force model to display 2 columns
-  model->setColumnCount(2);
-  tree.setRootIndex(model->invisibleRootItem()->index());
 
-  tree.setWindowTitle(fileInfo.absoluteFilePath());
+  const QString title = fileInfo.absoluteFilePath();
   tree.header()->setSectionResizeMode(QHeaderView::ResizeToContents);
   tree.header()->setResizeContentsPrecision(0);
   tree.setEditTriggers(QAbstractItemView::NoEditTriggers);
-  tree.expandAll();
   tree.show();
 
-  QJsonValue json = KtUtils::Json::fromStandardItem(row.at(0));
-  doc = QJsonDocument(json.toObject());
-  QFile output(fileInfo.absoluteDir().absoluteFilePath(
-      fileInfo.completeBaseName() + "_out.json"));
-  output.open(QFile::WriteOnly | QFile::Text | QFile::Truncate);
-  output.write(doc.toJson(QJsonDocument::Indented));
-  output.close();
-  QDesktopServices::openUrl(output.fileName());
+  // File is mapped and parsed in background, window stays responsive.
+  tree.setWindowTitle(QStringLiteral("%1 - loading").arg(title));
+  KtUtils::Json::LoadTask* task =
+      KtUtils::Json::loadAsync(fileInfo.absoluteFilePath(), model);
+  // Mapped file is read by parsing, 100% shows while parsing.
+  QObject::connect(task, &KtUtils::Json::LoadTask::progress, &tree,
+                   [&tree, title, fileInfo](qint64 bytesRead, qint64) {
+                     tree.setWindowTitle(
+                         QStringLiteral("%1 - loading %2%").arg(title).arg(
+                             fileInfo.size() ? bytesRead * 100 / fileInfo.size()
+                                             : 100));
+                   });
+  QObject::connect(
+      task, &KtUtils::Json::LoadTask::finished, &tree,
+      [&tree, model, task, title, fileInfo](bool success) {
+        tree.setWindowTitle(title);
+        if (!success) {
+          QMessageBox::warning(&tree, title, task->errorString());
+          return;
+        }
+        tree.expand(model->index(0, 0));
+
+        const QJsonValue json = model->json();
+        const QJsonDocument doc = json.isArray()
+                                      ? QJsonDocument(json.toArray())
+                                      : QJsonDocument(json.toObject());
+        QFile output(fileInfo.absoluteDir().absoluteFilePath(
+            fileInfo.completeBaseName() + "_out.json"));
+        output.open(QFile::WriteOnly | QFile::Text | QFile::Truncate);
+        output.write(doc.toJson(QJsonDocument::Indented));
+        output.close();
+        QDesktopServices::openUrl(output.fileName());
+      });
 
   return app.exec();
 }
@@ -0,0 +1,298 @@
+#ifndef KTUTILS_COROUTINE_HPP
+#define KTUTILS_COROUTINE_HPP
+
+#include "Global.hpp"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define KTUTILS_HAS_COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+/**
+ * Coroutine layer over Qt's event loop, available when built with C++20.
+ *
+ * A suspended coroutine costs one heap frame, nothing is polled and no
+ * nested event loop is run, e.g.
+ *
+ *   KtUtils::Task<int> Download(QNetworkReply* reply) {
+ *     if (!co_await KtUtils::signal(reply, &QNetworkReply::finished)) {
+ *       co_return -1;  // Reply is destroyed.
+ *     }
+ *     co_await KtUtils::delay(50);
+ *     co_return co_await QtConcurrent::run(&Parse, reply->readAll());
+ *   }
+ *
+ * Coroutines are resumed by the event loop of the thread which suspends it,
+ * so that thread must run an event loop.
+ */
+namespace KtUtils {
+template <typename T = void>
+class Task;
+
+/* ================ Task ================ */
+// Result of a task, shared between coroutine frame and Task objects.
+struct TaskStateBase {
+  std::coroutine_handle<> continuation;
+  std::exception_ptr exception;
+  bool finished = false;
+  bool observed = false;  // Result is taken by co_await or result().
+
+  TaskStateBase() = default;
+  TaskStateBase(const TaskStateBase&) = delete;
+  TaskStateBase& operator=(const TaskStateBase&) = delete;
+
+  // Exception of a fire and forget task is never rethrown, log it instead.
+  ~TaskStateBase() {
+    if (!exception || observed) return;
+    try {
+      std::rethrow_exception(exception);
+    } catch (const std::exception& e) {
+      qWarning() << "KtUtils::Task: unhandled exception:" << e.what();
+    } catch (...) {
+      qWarning() << "KtUtils::Task: unhandled exception";
+    }
+  }
+};
+
+template <typename T>
+struct TaskState : TaskStateBase {
+  std::optional<T> value;
+};
+
+template <>
+struct TaskState<void> : TaskStateBase {};
+
+template <typename T>
+class TaskPromiseBase {
+ public:
+  std::suspend_never initial_suspend() noexcept { return {}; }
+
+  auto final_suspend() noexcept {
+    // Frame destroys itself, then continues the awaiting coroutine.
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<> handle) noexcept {
+        std::shared_ptr<TaskState<T>> taskState = state;
+        handle.destroy();
+        taskState->finished = true;
+        if (taskState->continuation) return taskState->continuation;
+        return std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+
+      std::shared_ptr<TaskState<T>> state;
+    };
+    return FinalAwaiter{state};
+  }
+
+  void unhandled_exception() { state->exception = std::current_exception(); }
+
+  Task<T> get_return_object() { return Task<T>(state); }
+
+ protected:
+  std::shared_ptr<TaskState<T>> state = std::make_shared<TaskState<T>>();
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase<T> {
+ public:
+  template <typename U>
+  void return_value(U&& value) {
+    this->state->value.emplace(std::forward<U>(value));
+  }
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase<void> {
+ public:
+  void return_void() {}
+};
+
+/**
+ * \brief Coroutine type, starts immediately when called and runs until the
+ *        first suspension.
+ *
+ * Task may be discarded to fire and forget, the coroutine still runs to its
+ * end, and an exception escaped from it is logged by qWarning(). Or co_await
+ * it in another coroutine of the same thread to get result.
+ */
+template <typename T>
+class Task {
+ public:
+  using promise_type = TaskPromise<T>;
+
+  bool isFinished() const { return state->finished; }
+
+  /** \brief Result of a finished task, rethrow exception escaped from the
+   *         coroutine. */
+  T result() const {
+    state->observed = true;
+    if (state->exception) std::rethrow_exception(state->exception);
+    if constexpr (std::is_void_v<T>) {
+      return;
+    } else {
+      return *state->value;
+    }
+  }
+
+  auto operator co_await() const noexcept {
+    struct Awaiter {
+      bool await_ready() const noexcept { return state->finished; }
+      void await_suspend(std::coroutine_handle<> handle) noexcept {
+        state->continuation = handle;
+      }
+      T await_resume() const {
+        state->observed = true;
+        if (state->exception) std::rethrow_exception(state->exception);
+        if constexpr (std::is_void_v<T>) {
+          return;
+        } else {
+          return std::move(*state->value);
+        }
+      }
+
+      std::shared_ptr<TaskState<T>> state;
+    };
+    return Awaiter{state};
+  }
+
+ private:
+  friend class TaskPromiseBase<T>;
+  explicit Task(std::shared_ptr<TaskState<T>> taskState)
+      : state(std::move(taskState)) {}
+
+  std::shared_ptr<TaskState<T>> state;
+};
+/* ================ Task ================ */
+
+/* ================ Awaitables ================ */
+/** \brief Awaiter of delay(). */
+class DelayAwaiter {
+ public:
+  explicit DelayAwaiter(double timeout_milliseconds)
+      : interval(qMax(qCeil(timeout_milliseconds), 0)) {}
+
+  // Always suspend, so that delay(0) yields to the event loop.
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    QTimer::singleShot(interval, Qt::PreciseTimer,
+                       [handle] { handle.resume(); });
+  }
+  void await_resume() const noexcept {}
+
+ private:
+  int interval;
+};
+
+/**
+ * \brief Suspend current coroutine for given interval, resumed by a timer in
+ *        current thread.
+ */
+inline DelayAwaiter delay(double timeout_milliseconds) {
+  return DelayAwaiter(timeout_milliseconds);
+}
+
+/** \overload delay */
+template <class Rep, class Period>
+inline DelayAwaiter delay(
+    const std::chrono::duration<Rep, Period>& timeout_duration) {
+  return DelayAwaiter(
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          timeout_duration)
+          .count());
+}
+
+/** \brief Awaiter of signal(). */
+template <typename Sender, typename Signal>
+class SignalAwaiter {
+ public:
+  SignalAwaiter(const Sender* sender, Signal signal)
+      : sender(sender), signal(signal) {}
+
+  bool await_ready() const noexcept { return !sender; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    // Receiver in current thread, signals from other threads are queued.
+    auto context = new QObject;
+    auto resumed = std::make_shared<bool>(false);
+    auto finish = [this, handle, context, resumed](bool result) {
+      if (*resumed) return;
+      *resumed = true;
+      emitted = result;
+      context->deleteLater();
+      handle.resume();
+    };
+    QObject::connect(sender, signal, context, [finish] { finish(true); });
+    QObject::connect(sender, &QObject::destroyed, context,
+                     [finish] { finish(false); });
+  }
+  bool await_resume() const noexcept { return emitted; }
+
+ private:
+  const Sender* sender;
+  Signal signal;
+  bool emitted = false;
+};
+
+/**
+ * \brief Suspend current coroutine until given signal is emitted.
+ *
+ * co_await returns true if the signal is emitted, or false if sender is
+ * destroyed before that.
+ */
+template <typename Sender, typename Signal>
+inline SignalAwaiter<Sender, Signal> signal(const Sender* sender,
+                                            Signal signal) {
+  return SignalAwaiter<Sender, Signal>(sender, signal);
+}
+
+/** \brief Awaiter of QFuture, see operator co_await(const QFuture<T>&). */
+template <typename T>
+class FutureAwaiter {
+ public:
+  explicit FutureAwaiter(const QFuture<T>& future) : future(future) {}
+
+  bool await_ready() const { return future.isFinished(); }
+  void await_suspend(std::coroutine_handle<> handle) {
+    auto watcher = new QFutureWatcher<T>;
+    QObject::connect(watcher, &QFutureWatcherBase::finished, watcher,
+                     [watcher, handle] {
+                       watcher->deleteLater();
+                       handle.resume();
+                     });
+    watcher->setFuture(future);
+  }
+  // Result of canceled future without result is default constructed.
+  T await_resume() {
+    future.waitForFinished();
+    if constexpr (std::is_void_v<T>) {
+      return;
+    } else {
+      return (future.resultCount() > 0) ? future.result() : T();
+    }
+  }
+
+ private:
+  QFuture<T> future;
+};
+/* ================ Awaitables ================ */
+}  // namespace KtUtils
+
+QT_BEGIN_NAMESPACE
+/**
+ * \brief Make QFuture awaitable, e.g. co_await QtConcurrent::run(...).
+ *
+ * Declared in QFuture's namespace to be found by argument dependent lookup.
+ */
+template <typename T>
+inline KtUtils::FutureAwaiter<T> operator co_await(const QFuture<T>& future) {
+  return KtUtils::FutureAwaiter<T>(future);
+}
+QT_END_NAMESPACE
+
+#endif  // __cpp_impl_coroutine
+#endif  // KTUTILS_COROUTINE_HPP
@@ -0,0 +1,176 @@
+#ifndef KTUTILS_DEBOUNCE_HPP
+#define KTUTILS_DEBOUNCE_HPP
+
+#include "TimerWheel.hpp"
+
+namespace KtUtils {
+/** \brief Edges of a burst of calls to invoke at, for debounce() and
+ *         throttle(). */
+enum DebounceEdge {
+  LeadingEdge = 0x1,   // Invoke immediately at the first call of a burst.
+  TrailingEdge = 0x2,  // Invoke with arguments of the last call of a burst.
+};
+
+/**
+ * \brief Wrap f, so that calls are invoked only after wait_milliseconds
+ *        passed without another call, e.g.
+ *        auto search = debounce<QString>(
+ *            [](const QString& text) { ... }, 300);
+ *        connect(edit, &QLineEdit::textChanged, search);
+ *
+ * Timers are scheduled in TimerWheel::instance() of the calling thread, no
+ * QTimer is created for each function. The returned function is thread safe,
+ * a window belongs to the thread which opened it, and trailing call is
+ * invoked in that thread. A call in another thread, or after the thread
+ * exited, drops the pending window with its trailing call and opens a new
+ * one in the calling thread.
+ * \param edges   Combination of DebounceEdge.
+ */
+template <typename... Args, typename F>
+std::function<void(Args...)> debounce(F f, double wait_milliseconds,
+                                      int edges = TrailingEdge);
+
+/**
+ * \brief Wrap f, so that calls are invoked at most once per
+ *        interval_milliseconds.
+ * \sa debounce
+ */
+template <typename... Args, typename F>
+std::function<void(Args...)> throttle(F f, double interval_milliseconds,
+                                      int edges = LeadingEdge | TrailingEdge);
+
+/** \overload debounce */
+template <typename... Args, typename F, class Rep, class Period>
+std::function<void(Args...)> debounce(
+    F f, const std::chrono::duration<Rep, Period>& wait_duration,
+    int edges = TrailingEdge);
+
+/** \overload throttle */
+template <typename... Args, typename F, class Rep, class Period>
+std::function<void(Args...)> throttle(
+    F f, const std::chrono::duration<Rep, Period>& interval_duration,
+    int edges = LeadingEdge | TrailingEdge);
+
+/* ================ Definition ================ */
+// State shared by copies of a debounced or throttled function.
+template <typename... Args>
+class RateLimiter
+    : public std::enable_shared_from_this<RateLimiter<Args...>> {
+ public:
+  enum Mode { Debounce, Throttle };
+
+  RateLimiter(std::function<void(Args...)> fn, double interval, int edges,
+              Mode mode)
+      : fn(std::move(fn)), interval(interval), edges(edges), mode(mode) {}
+
+  void call(Args... args) {
+    const std::shared_ptr<TimerWheel> current =
+        TimerWheel::instanceHandle().lock();
+    bool leading = false;
+    {
+      QMutexLocker locker(&mutex);
+      if (wheel.lock() != current) {
+        // Timer of another wheel can't be canceled here, its expiry is
+        // ignored by window number.
+        timer = 0;
+        trailing = nullptr;
+      }
+      const bool idle = (timer == 0);
+      if (idle && (edges & LeadingEdge)) {
+        leading = true;
+      } else if (edges & TrailingEdge) {
+        // Invoked only through this, so capturing this is safe.
+        trailing = [this, args...] { fn(args...); };
+      }
+
+      // Debounce restarts the window on every call, throttle doesn't.
+      if ((mode == Debounce) && (timer != 0)) {
+        current->cancel(timer);
+        timer = 0;
+      }
+      if (timer == 0) start(current);
+    }
+    if (leading) fn(args...);
+  }
+
+ private:
+  // Open a window in wheel of current thread, locked.
+  void start(const std::shared_ptr<TimerWheel>& current) {
+    wheel = current;
+    const quint64 number = ++window;
+    std::weak_ptr<RateLimiter> weak = this->shared_from_this();
+    timer = current->schedule(interval, [weak, number] {
+      if (auto self = weak.lock()) self->expire(number);
+    });
+  }
+
+  void expire(quint64 number) {
+    std::function<void(void)> call;
+    {
+      QMutexLocker locker(&mutex);
+      // Dropped by a call in another thread.
+      if (number != window) return;
+      timer = 0;
+      if (!trailing) return;
+      call = std::move(trailing);
+      trailing = nullptr;
+      // Keep the rate after the trailing call.
+      if (mode == Throttle) start(wheel.lock());
+    }
+    call();
+  }
+
+  std::function<void(Args...)> fn;
+  double interval;
+  int edges;
+  Mode mode;
+  QMutex mutex;  // Guards members below, not held while invoking fn.
+  std::weak_ptr<TimerWheel> wheel;  // Wheel the window is scheduled in.
+  TimerWheel::TimerId timer = 0;    // Window is open if not 0.
+  quint64 window = 0;               // Number of latest window.
+  std::function<void(void)> trailing;
+};
+
+template <typename... Args, typename F>
+inline std::function<void(Args...)> debounce(F f, double wait_milliseconds,
+                                             int edges) {
+  auto limiter = std::make_shared<RateLimiter<Args...>>(
+      std::move(f), wait_milliseconds, edges, RateLimiter<Args...>::Debounce);
+  return [limiter](Args... args) { limiter->call(args...); };
+}
+
+template <typename... Args, typename F>
+inline std::function<void(Args...)> throttle(F f,
+                                             double interval_milliseconds,
+                                             int edges) {
+  auto limiter = std::make_shared<RateLimiter<Args...>>(
+      std::move(f), interval_milliseconds, edges,
+      RateLimiter<Args...>::Throttle);
+  return [limiter](Args... args) { limiter->call(args...); };
+}
+
+template <typename... Args, typename F, class Rep, class Period>
+inline std::function<void(Args...)> debounce(
+    F f, const std::chrono::duration<Rep, Period>& wait_duration, int edges) {
+  return debounce<Args...>(
+      std::move(f),
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          wait_duration)
+          .count(),
+      edges);
+}
+
+template <typename... Args, typename F, class Rep, class Period>
+inline std::function<void(Args...)> throttle(
+    F f, const std::chrono::duration<Rep, Period>& interval_duration,
+    int edges) {
+  return throttle<Args...>(
+      std::move(f),
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          interval_duration)
+          .count(),
+      edges);
+}
+}  // namespace KtUtils
+
+#endif  // KTUTILS_DEBOUNCE_HPP
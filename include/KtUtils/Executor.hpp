@@ -0,0 +1,183 @@
+#ifndef KTUTILS_EXECUTOR_HPP
+#define KTUTILS_EXECUTOR_HPP
+
+#include "TaskQueue.hpp"
+
+namespace KtUtils {
+/**
+ * \brief Cancellation flag shared by copies, backed by a WaitCondition so it
+ *        can be waited for, e.g. WaitFor(1000, flags, token.condition()).
+ */
+class KTUTILS_EXPORT CancellationToken {
+ public:
+  CancellationToken();
+
+  /** \brief Request cancellation, thread safe. */
+  void cancel();
+  bool isCanceled() const;
+  /** \brief Notified when canceled. */
+  const WaitCondition& condition() const;
+
+ private:
+  std::shared_ptr<WaitCondition> d;
+};
+
+/**
+ * \brief Work stealing executor for fine grained tasks.
+ *
+ * Each worker thread owns a deque: tasks posted from a worker go to its own
+ * deque and are run LIFO, other tasks are distributed round robin. Idle
+ * workers steal the oldest tasks from others, so there's no single shared
+ * queue to contend for.
+ *
+ * As a TaskQueue, threads waiting in Wait()/WaitFor() with the executor also
+ * help to run its tasks.
+ */
+class KTUTILS_EXPORT Executor : public TaskQueue {
+ public:
+  /** \param workerCount Number of worker threads, at least 1. */
+  explicit Executor(int workerCount = QThread::idealThreadCount());
+  /** \brief Stop workers, pending tasks are dropped and their futures are
+   *         canceled. */
+  ~Executor() override;
+
+  int workerCount() const;
+
+  void post(Task task, double estimate_milliseconds =
+                           std::numeric_limits<double>::infinity()) override;
+  bool runOne(double max_estimate_milliseconds =
+                  std::numeric_limits<double>::infinity()) override;
+  int pendingCount() const override;
+
+  /**
+   * \brief Run f() in worker thread.
+   * \return Future of the result, canceling it before f() starts skips f().
+   */
+  template <typename F>
+  auto run(F f) -> QFuture<decltype(f())>;
+  /** \brief Run f() in worker thread, skipped if token is canceled before it
+   *         starts. */
+  template <typename F>
+  auto run(const CancellationToken& token, F f) -> QFuture<decltype(f())>;
+
+ private:
+  friend class ExecutorWorker;
+  struct Private;
+  QScopedPointer<Private> executor;
+};
+
+/* ================ Future helpers ================ */
+// Promise of a future, finished as canceled if dropped without result.
+template <typename R>
+struct FuturePromise {
+  QFutureInterface<R> promise;
+
+  FuturePromise() { promise.reportStarted(); }
+  ~FuturePromise() {
+    if (!promise.isFinished()) {
+      promise.reportCanceled();
+      promise.reportFinished();
+    }
+  }
+  FuturePromise(const FuturePromise&) = delete;
+  FuturePromise& operator=(const FuturePromise&) = delete;
+};
+
+// Report result of f() into promise and finish it.
+template <typename R, typename F>
+inline void FinishPromise(QFutureInterface<R>& promise, F&& f) {
+  promise.reportResult(f());
+  promise.reportFinished();
+}
+
+template <typename F>
+inline void FinishPromise(QFutureInterface<void>& promise, F&& f) {
+  f();
+  promise.reportFinished();
+}
+
+// Call continuation with result of finished future.
+template <typename T, typename F>
+struct ContinuationTraits {
+  using Result = decltype(std::declval<F&>()(std::declval<const T&>()));
+  static Result call(F& f, const QFuture<T>& future) {
+    return f(future.result());
+  }
+};
+
+template <typename F>
+struct ContinuationTraits<void, F> {
+  using Result = decltype(std::declval<F&>()());
+  static Result call(F& f, const QFuture<void>&) { return f(); }
+};
+/* ================ Future helpers ================ */
+
+/**
+ * \brief Run f(result) in context's thread when future finished.
+ *
+ * For QFuture<void>, f takes no argument.
+ * \return Future of f's result, canceled if given future is canceled or
+ *         context is destroyed before that.
+ */
+template <typename T, typename F>
+QFuture<typename ContinuationTraits<T, F>::Result> then(
+    const QFuture<T>& future, QObject* context, F f);
+
+/* ================ Definition ================ */
+template <typename F>
+inline auto Executor::run(F f) -> QFuture<decltype(f())> {
+  using R = decltype(f());
+  auto state = std::make_shared<FuturePromise<R>>();
+  post([state, f]() mutable {
+    if (!state->promise.isCanceled()) FinishPromise(state->promise, f);
+  });
+  return state->promise.future();
+}
+
+template <typename F>
+inline auto Executor::run(const CancellationToken& token, F f)
+    -> QFuture<decltype(f())> {
+  using R = decltype(f());
+  auto state = std::make_shared<FuturePromise<R>>();
+  post([token, state, f]() mutable {
+    if (!token.isCanceled() && !state->promise.isCanceled()) {
+      FinishPromise(state->promise, f);
+    }
+  });
+  return state->promise.future();
+}
+
+template <typename T, typename F>
+inline QFuture<typename ContinuationTraits<T, F>::Result> then(
+    const QFuture<T>& future, QObject* context, F f) {
+  using Traits = ContinuationTraits<T, F>;
+  auto state = std::make_shared<FuturePromise<typename Traits::Result>>();
+  const auto ret = state->promise.future();
+  if (Q_UNLIKELY(!context)) {
+    qWarning() << "KtUtils::then: context is nullptr";
+    return ret;  // Canceled when state is dropped.
+  }
+
+  // Watcher lives in context's thread, and is destroyed with context.
+  QMetaObject::invokeMethod(
+      context,
+      [future, context, state, f]() mutable {
+        auto watcher = new QFutureWatcher<T>(context);
+        QObject::connect(
+            watcher, &QFutureWatcherBase::finished, watcher,
+            [future, watcher, state, f]() mutable {
+              if (!future.isCanceled()) {
+                FinishPromise(state->promise, [&f, &future] {
+                  return Traits::call(f, future);
+                });
+              }
+              watcher->deleteLater();
+            });
+        watcher->setFuture(future);
+      },
+      Qt::QueuedConnection);
+  return ret;
+}
+}  // namespace KtUtils
+
+#endif  // KTUTILS_EXECUTOR_HPP
@@ -2,13 +2,16 @@
 #define KTUTILS_GLOBAL_HPP
 #ifdef __cplusplus
 
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <memory>
 
 #define QT_MESSAGELOGCONTEXT
 #include <QtCore/QtCore>
 #include <QtConcurrent/QtConcurrent>
 #include <QtGui/QtGui>
+#include <QtWidgets/QtWidgets>
 #include <QtSvg/QtSvg>
 
 #ifdef KTUTILS_SHARED_LIBRARY
@@ -23,6 +26,12 @@ namespace KtUtils {
 /**
  * \brief Wait when specific criteria is satisfied, but NOT blocking
  *                Qt's event loop.
+ *
+ * In threads without a running Qt event loop, e.g. std::thread or
+ * QThreadPool workers, the thread sleeps between checks of isValid with
+ * WaitBackoff{1, 1.5, 10} instead of spinning. Events of the thread, e.g.
+ * timers and queued signals, are still processed while sleeping if it has an
+ * event dispatcher.
  * \param isValid Callback to tell if specific criteria is satisfied and we can
  *                stop waiting.
  * \param flags   Flags for run Qt's eventloop, e.g. using
@@ -80,6 +89,357 @@ template <class Clock, class Duration>
 bool WaitUntil(const std::chrono::time_point<Clock, Duration>& timeout_time,
                QEventLoop::ProcessEventsFlags flags = QEventLoop::AllEvents,
                const std::function<bool(void)>& isValid = {});
+
+/**
+ * \brief Opt-in backoff policy for predicate based waits.
+ *
+ * Instead of spinning Qt's event loop, the waiting thread sleeps in the event
+ * dispatcher between predicate checks, events are still processed while
+ * sleeping. Sleep interval starts from initialInterval, multiplies by
+ * growthFactor after each failed check, and is limited by maxInterval.
+ * initialInterval is at least 1ms, growthFactor at least 1, and maxInterval
+ * at least initialInterval.
+ */
+struct WaitBackoff {
+  double initialInterval = 1;  // Milliseconds.
+  double growthFactor = 2;
+  double maxInterval = 50;  // Milliseconds.
+};
+
+/** \brief Cost of a wait, reported by waits with WaitBackoff. */
+struct WaitStatistics {
+  quint64 predicateCalls = 0;
+  qint64 cpuTime = 0;      // Nanoseconds of CPU time used by waiting thread.
+  qint64 elapsedTime = 0;  // Nanoseconds of wall time.
+};
+
+/**
+ * \brief Wait when specific criteria is satisfied, sleep with given backoff
+ *        policy between checks.
+ * \param isValid     Callback to tell if specific criteria is satisfied.
+ * \param flags       Flags for run Qt's eventloop.
+ * \param backoff     Sleep intervals between calls of isValid.
+ * \param statistics  Cost of the wait, ignored if nullptr.
+ */
+KTUTILS_EXPORT void Wait(const std::function<bool(void)>& isValid,
+                         QEventLoop::ProcessEventsFlags flags,
+                         const WaitBackoff& backoff,
+                         WaitStatistics* statistics = nullptr);
+
+/**
+ * \brief Wait for given time interval or specific criteria satisfied(if
+ *        given), sleep with given backoff policy between checks.
+ * \param timeout_milliseconds  Maximum interval to wait for.
+ * \param flags       Flags for run Qt's eventloop.
+ * \param isValid     Callback to tell if specific criteria is satisfied.
+ * \param backoff     Sleep intervals between calls of isValid.
+ * \param statistics  Cost of the wait, ignored if nullptr.
+ * \return false if isValid is given and return false until timeout,
+ *         otherwise true.
+ */
+KTUTILS_EXPORT bool WaitFor(double timeout_milliseconds,
+                            QEventLoop::ProcessEventsFlags flags,
+                            const std::function<bool(void)>& isValid,
+                            const WaitBackoff& backoff,
+                            WaitStatistics* statistics = nullptr);
+
+/**
+ * \brief Wait until given time or specific criteria satisfied(if given),
+ *        sleep with given backoff policy between checks.
+ * \sa WaitFor
+ */
+KTUTILS_EXPORT bool WaitUntil(const QDateTime& timeout_time,
+                              QEventLoop::ProcessEventsFlags flags,
+                              const std::function<bool(void)>& isValid,
+                              const WaitBackoff& backoff,
+                              WaitStatistics* statistics = nullptr);
+
+/** \overload WaitFor */
+template <class Rep, class Period>
+bool WaitFor(const std::chrono::duration<Rep, Period>& timeout_duration,
+             QEventLoop::ProcessEventsFlags flags,
+             const std::function<bool(void)>& isValid,
+             const WaitBackoff& backoff, WaitStatistics* statistics = nullptr);
+
+/** \overload WaitUntil */
+template <class Clock, class Duration>
+bool WaitUntil(const std::chrono::time_point<Clock, Duration>& timeout_time,
+               QEventLoop::ProcessEventsFlags flags,
+               const std::function<bool(void)>& isValid,
+               const WaitBackoff& backoff,
+               WaitStatistics* statistics = nullptr);
+
+class TaskQueue;
+
+/**
+ * \brief Wait when specific criteria is satisfied, run pending tasks of given
+ *        queue in current thread while waiting, instead of idling.
+ *
+ * Only tasks estimated to finish in max_task_milliseconds are taken, and if a
+ * task overruns it, no more task is taken during this wait. Events are
+ * processed between tasks.
+ * \param isValid     Callback to tell if specific criteria is satisfied.
+ * \param flags       Flags for run Qt's eventloop.
+ * \param queue       Queue to take tasks from, e.g.
+ *                    TaskQueue::globalInstance().
+ * \param max_task_milliseconds Maximum estimated run time of tasks to take.
+ */
+KTUTILS_EXPORT void Wait(const std::function<bool(void)>& isValid,
+                         QEventLoop::ProcessEventsFlags flags,
+                         TaskQueue& queue, double max_task_milliseconds = 10);
+
+/**
+ * \brief Wait for given time interval or specific criteria satisfied(if
+ *        given), run pending tasks of given queue while waiting.
+ *
+ * Tasks are also limited by remaining time, so the deadline is kept unless
+ * a task overruns its estimate.
+ * \sa Wait(const std::function<bool(void)>&, QEventLoop::ProcessEventsFlags,
+ *         TaskQueue&, double)
+ * \return false if isValid is given and return false until timeout,
+ *         otherwise true.
+ */
+KTUTILS_EXPORT bool WaitFor(double timeout_milliseconds,
+                            QEventLoop::ProcessEventsFlags flags,
+                            const std::function<bool(void)>& isValid,
+                            TaskQueue& queue,
+                            double max_task_milliseconds = 10);
+
+/** \overload WaitFor */
+template <class Rep, class Period>
+bool WaitFor(const std::chrono::duration<Rep, Period>& timeout_duration,
+             QEventLoop::ProcessEventsFlags flags,
+             const std::function<bool(void)>& isValid, TaskQueue& queue,
+             double max_task_milliseconds = 10);
+
+/**
+ * \brief Condition for Wait(), WaitFor() and WaitUntil() to wait for instead
+ *        of polling a predicate.
+ *
+ * Producers call notify() from any thread, waiting threads sleep in their
+ * event dispatchers and are woken up immediately by the notification.
+ * Threads without event dispatcher, e.g. std::thread, block on a wait
+ * condition, as there's no event to process.
+ * Once notified, the condition keeps notified until reset(), so notification
+ * before waiting is never lost.
+ */
+class KTUTILS_EXPORT WaitCondition {
+ public:
+  WaitCondition();
+  ~WaitCondition();
+  WaitCondition(const WaitCondition&) = delete;
+  WaitCondition& operator=(const WaitCondition&) = delete;
+
+  /** \brief Mark as notified and wake up all waiting threads, thread safe. */
+  void notify();
+  /** \brief Clear notified state, thread safe. */
+  void reset();
+  bool isNotified() const;
+
+ private:
+  friend class WaitConditionWaiter;
+  struct Private;
+  QScopedPointer<Private> d;
+};
+
+/**
+ * \brief Wait until condition is notified WITHOUT blocking Qt's event loop.
+ * \param condition Condition to wait for.
+ * \param flags   Flags for run Qt's eventloop, e.g. using
+ *                QEventLoop::ExcludeUserInputEvents to wait without allowing
+ *                user input.
+ */
+KTUTILS_EXPORT void Wait(
+    const WaitCondition& condition,
+    QEventLoop::ProcessEventsFlags flags = QEventLoop::AllEvents);
+
+/**
+ * \brief Wait for given time interval or condition notified WITHOUT blocking
+ *        Qt's event loop.
+ * \param timeout_milliseconds  Maximum interval to wait for.
+ * \param flags   Flags for run Qt's eventloop.
+ * \param condition Condition to wait for, immediately return when notified.
+ * \return true if condition is notified before timeout, otherwise false.
+ */
+KTUTILS_EXPORT bool WaitFor(double timeout_milliseconds,
+                            QEventLoop::ProcessEventsFlags flags,
+                            const WaitCondition& condition);
+
+/**
+ * \brief Wait until given time or condition notified WITHOUT blocking Qt's
+ *        event loop.
+ * \param timeout_time  Deadline time point to wait until.
+ * \param flags   Flags for run Qt's eventloop.
+ * \param condition Condition to wait for, immediately return when notified.
+ * \return true if condition is notified before timeout, otherwise false.
+ */
+KTUTILS_EXPORT bool WaitUntil(const QDateTime& timeout_time,
+                              QEventLoop::ProcessEventsFlags flags,
+                              const WaitCondition& condition);
+
+/** \overload WaitFor */
+template <class Rep, class Period>
+bool WaitFor(const std::chrono::duration<Rep, Period>& timeout_duration,
+             QEventLoop::ProcessEventsFlags flags,
+             const WaitCondition& condition);
+
+/** \overload WaitUntil */
+template <class Clock, class Duration>
+bool WaitUntil(const std::chrono::time_point<Clock, Duration>& timeout_time,
+               QEventLoop::ProcessEventsFlags flags,
+               const WaitCondition& condition);
+
+/**
+ * \brief Sleep until deadline WITHOUT blocking Qt's event loop.
+ *
+ * Woken up by TimerWheel::instance() of current thread instead of a dedicated
+ * timer, so many concurrent waits share one underlying timer.
+ * \param deadline  Deadline to wait until.
+ * \param flags     Flags for run Qt's eventloop.
+ */
+KTUTILS_EXPORT void WaitUntil(
+    const QDeadlineTimer& deadline,
+    QEventLoop::ProcessEventsFlags flags = QEventLoop::AllEvents);
+
+/**
+ * \brief Wait until deadline or condition notified WITHOUT blocking Qt's event
+ *        loop, deadline is tracked by TimerWheel::instance() of current thread.
+ * \param deadline  Deadline to wait until.
+ * \param flags     Flags for run Qt's eventloop.
+ * \param condition Condition to wait for, immediately return when notified.
+ * \return true if condition is notified before deadline, otherwise false.
+ */
+KTUTILS_EXPORT bool WaitUntil(const QDeadlineTimer& deadline,
+                              QEventLoop::ProcessEventsFlags flags,
+                              const WaitCondition& condition);
+
+/**
+ * \brief Wait until given signal is emitted or timeout WITHOUT blocking Qt's
+ *        event loop.
+ *
+ * Unlike Wait(), no predicate is polled: the signal notifies a WaitCondition
+ * directly from sender's thread, which wakes up the waiting thread.
+ * \param sender  Object emits the signal, may live in another thread.
+ * \param signal  Signal to wait for, e.g. &QThread::finished.
+ * \param timeout_milliseconds  Maximum interval to wait for, negative value
+ *                              means wait forever.
+ * \param flags   Flags for run Qt's eventloop, e.g. using
+ *                QEventLoop::ExcludeUserInputEvents to wait without allowing
+ *                user input.
+ * \return true if the signal is emitted before timeout, false if timeout or
+ *         sender is destroyed.
+ */
+template <typename Sender, typename Signal>
+bool WaitForSignal(const Sender* sender, Signal signal,
+                   double timeout_milliseconds = -1,
+                   QEventLoop::ProcessEventsFlags flags = QEventLoop::AllEvents);
+
+/** \overload WaitForSignal */
+template <typename Sender, typename Signal, class Rep, class Period>
+bool WaitForSignal(const Sender* sender, Signal signal,
+                   const std::chrono::duration<Rep, Period>& timeout_duration,
+                   QEventLoop::ProcessEventsFlags flags = QEventLoop::AllEvents);
+/**
+ * \brief Set of futures and signals to wait for in one event loop, used by
+ *        WaitAny() and WaitAll().
+ *
+ * Each item is driven by its completion signal, nothing is polled. Items can
+ * be added from QFuture, QFutureWatcher or (sender, signal) pair, the index of
+ * an item is the order it is added.
+ */
+class KTUTILS_EXPORT WaitGroup {
+ public:
+  WaitGroup();
+  ~WaitGroup();
+  WaitGroup(const WaitGroup&) = delete;
+  WaitGroup& operator=(const WaitGroup&) = delete;
+
+  /** \brief Item completes when future finished. \return Index of item. */
+  template <typename T>
+  int add(const QFuture<T>& future);
+  /** \brief Item completes when watcher emits finished().
+   *  \return Index of item. */
+  template <typename T>
+  int add(const QFutureWatcher<T>* watcher);
+  /** \brief Item completes when signal is emitted, and never completes if
+   *         sender is destroyed before that. \return Index of item. */
+  template <typename Sender, typename Signal>
+  int add(const Sender* sender, Signal signal);
+  /** \overload add */
+  template <typename Sender, typename Signal>
+  int add(const std::pair<Sender*, Signal>& item);
+
+  int count() const;
+  bool isCompleted(int index) const;
+
+  /**
+   * \brief Wait until any item completed or timeout WITHOUT blocking Qt's
+   *        event loop.
+   * \param timeout_milliseconds  Maximum interval to wait for, negative value
+   *                              means wait forever.
+   * \param flags   Flags for run Qt's eventloop.
+   * \return Index of the first completed item, or -1 if timeout or no item
+   *         could complete any more.
+   */
+  int waitAny(double timeout_milliseconds = -1,
+              QEventLoop::ProcessEventsFlags flags = QEventLoop::AllEvents);
+  /**
+   * \brief Wait until all items completed or timeout WITHOUT blocking Qt's
+   *        event loop.
+   * \sa waitAny
+   * \return true if all items completed, false if timeout or any item could
+   *         not complete any more.
+   */
+  bool waitAll(double timeout_milliseconds = -1,
+               QEventLoop::ProcessEventsFlags flags = QEventLoop::AllEvents);
+
+ private:
+  // Receiver of item connections, lives in current thread with the group.
+  QObject* context() const;
+  int addItem();
+  void complete(int index);
+  void abandon(int index);
+
+  struct Private;
+  QScopedPointer<Private> d;
+};
+
+/**
+ * \brief Wait until any of given items completed or timeout WITHOUT blocking
+ *        Qt's event loop.
+ *
+ * e.g. WaitAny(1000, QEventLoop::AllEvents, future,
+ *              std::make_pair(reply, &QNetworkReply::finished));
+ * \param timeout_milliseconds  Maximum interval to wait for, negative value
+ *                              means wait forever.
+ * \param flags   Flags for run Qt's eventloop.
+ * \param items   QFuture, QFutureWatcher pointer, or std::pair of sender
+ *                pointer and signal.
+ * \return Index of the first completed item, or -1 if timeout.
+ */
+template <typename... Items>
+int WaitAny(double timeout_milliseconds, QEventLoop::ProcessEventsFlags flags,
+            const Items&... items);
+
+/**
+ * \brief Wait until all of given items completed or timeout WITHOUT blocking
+ *        Qt's event loop.
+ * \sa WaitAny
+ * \return true if all items completed before timeout.
+ */
+template <typename... Items>
+bool WaitAll(double timeout_milliseconds, QEventLoop::ProcessEventsFlags flags,
+             const Items&... items);
+
+/** \overload WaitAny */
+template <class Rep, class Period, typename... Items>
+int WaitAny(const std::chrono::duration<Rep, Period>& timeout_duration,
+            QEventLoop::ProcessEventsFlags flags, const Items&... items);
+
+/** \overload WaitAll */
+template <class Rep, class Period, typename... Items>
+bool WaitAll(const std::chrono::duration<Rep, Period>& timeout_duration,
+             QEventLoop::ProcessEventsFlags flags, const Items&... items);
 /* ================ Declaration ================ */
 
 /* ================ Definition ================ */
@@ -101,6 +461,193 @@ inline bool WaitUntil(
     const std::function<bool(void)>& isValid) {
   return WaitFor(timeout_time - Clock::now(), flags, isValid);
 }
+
+template <class Rep, class Period>
+inline bool WaitFor(const std::chrono::duration<Rep, Period>& timeout_duration,
+                    QEventLoop::ProcessEventsFlags flags,
+                    const std::function<bool(void)>& isValid,
+                    const WaitBackoff& backoff, WaitStatistics* statistics) {
+  return WaitFor(
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          timeout_duration)
+          .count(),
+      flags, isValid, backoff, statistics);
+}
+
+template <class Clock, class Duration>
+inline bool WaitUntil(
+    const std::chrono::time_point<Clock, Duration>& timeout_time,
+    QEventLoop::ProcessEventsFlags flags,
+    const std::function<bool(void)>& isValid, const WaitBackoff& backoff,
+    WaitStatistics* statistics) {
+  return WaitFor(timeout_time - Clock::now(), flags, isValid, backoff,
+                 statistics);
+}
+
+template <class Rep, class Period>
+inline bool WaitFor(const std::chrono::duration<Rep, Period>& timeout_duration,
+                    QEventLoop::ProcessEventsFlags flags,
+                    const std::function<bool(void)>& isValid,
+                    TaskQueue& queue, double max_task_milliseconds) {
+  return WaitFor(
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          timeout_duration)
+          .count(),
+      flags, isValid, queue, max_task_milliseconds);
+}
+
+template <class Rep, class Period>
+inline bool WaitFor(const std::chrono::duration<Rep, Period>& timeout_duration,
+                    QEventLoop::ProcessEventsFlags flags,
+                    const WaitCondition& condition) {
+  return WaitFor(
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          timeout_duration)
+          .count(),
+      flags, condition);
+}
+
+template <class Clock, class Duration>
+inline bool WaitUntil(
+    const std::chrono::time_point<Clock, Duration>& timeout_time,
+    QEventLoop::ProcessEventsFlags flags, const WaitCondition& condition) {
+  return WaitFor(timeout_time - Clock::now(), flags, condition);
+}
+
+template <typename Sender, typename Signal>
+inline bool WaitForSignal(const Sender* sender, Signal signal,
+                          double timeout_milliseconds,
+                          QEventLoop::ProcessEventsFlags flags) {
+  if (!sender) return false;
+
+  // Shared with the connections, which may be invoked by sender's thread
+  // until disconnected.
+  struct State {
+    WaitCondition condition;
+    std::atomic<bool> emitted{false};
+  };
+  auto state = std::make_shared<State>();
+  // Connections without context are direct, invoked in sender's thread.
+  const QMetaObject::Connection signalConnection =
+      QObject::connect(sender, signal, [state] {
+        state->emitted.store(true);
+        state->condition.notify();
+      });
+  const QMetaObject::Connection destroyedConnection =
+      QObject::connect(sender, &QObject::destroyed,
+                       [state] { state->condition.notify(); });
+
+  if (timeout_milliseconds >= 0) {
+    WaitFor(timeout_milliseconds, flags, state->condition);
+  } else {
+    Wait(state->condition, flags);
+  }
+  QObject::disconnect(signalConnection);
+  QObject::disconnect(destroyedConnection);
+  return state->emitted.load();
+}
+
+template <typename Sender, typename Signal, class Rep, class Period>
+inline bool WaitForSignal(
+    const Sender* sender, Signal signal,
+    const std::chrono::duration<Rep, Period>& timeout_duration,
+    QEventLoop::ProcessEventsFlags flags) {
+  return WaitForSignal(
+      sender, signal,
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          timeout_duration)
+          .count(),
+      flags);
+}
+template <typename T>
+inline int WaitGroup::add(const QFuture<T>& future) {
+  const int index = addItem();
+  if (future.isFinished()) {
+    complete(index);
+  } else {
+    // Watcher is owned by context, finished() is delivered in this thread.
+    auto watcher = new QFutureWatcher<T>(context());
+    QObject::connect(watcher, &QFutureWatcherBase::finished, context(),
+                     [this, index] { complete(index); });
+    watcher->setFuture(future);
+  }
+  return index;
+}
+
+template <typename T>
+inline int WaitGroup::add(const QFutureWatcher<T>* watcher) {
+  const int index = addItem();
+  if (!watcher) {
+    abandon(index);
+  } else if (watcher->future().isFinished()) {
+    complete(index);
+  } else {
+    QObject::connect(watcher, &QFutureWatcherBase::finished, context(),
+                     [this, index] { complete(index); });
+    QObject::connect(watcher, &QObject::destroyed, context(),
+                     [this, index] { abandon(index); });
+  }
+  return index;
+}
+
+template <typename Sender, typename Signal>
+inline int WaitGroup::add(const Sender* sender, Signal signal) {
+  const int index = addItem();
+  if (!sender) {
+    abandon(index);
+  } else {
+    QObject::connect(sender, signal, context(),
+                     [this, index] { complete(index); });
+    QObject::connect(sender, &QObject::destroyed, context(),
+                     [this, index] { abandon(index); });
+  }
+  return index;
+}
+
+template <typename Sender, typename Signal>
+inline int WaitGroup::add(const std::pair<Sender*, Signal>& item) {
+  return add(static_cast<const Sender*>(item.first), item.second);
+}
+
+template <typename... Items>
+inline int WaitAny(double timeout_milliseconds,
+                   QEventLoop::ProcessEventsFlags flags,
+                   const Items&... items) {
+  WaitGroup group;
+  (void)std::initializer_list<int>{group.add(items)...};
+  return group.waitAny(timeout_milliseconds, flags);
+}
+
+template <typename... Items>
+inline bool WaitAll(double timeout_milliseconds,
+                    QEventLoop::ProcessEventsFlags flags,
+                    const Items&... items) {
+  WaitGroup group;
+  (void)std::initializer_list<int>{group.add(items)...};
+  return group.waitAll(timeout_milliseconds, flags);
+}
+
+template <class Rep, class Period, typename... Items>
+inline int WaitAny(const std::chrono::duration<Rep, Period>& timeout_duration,
+                   QEventLoop::ProcessEventsFlags flags,
+                   const Items&... items) {
+  return WaitAny(
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          timeout_duration)
+          .count(),
+      flags, items...);
+}
+
+template <class Rep, class Period, typename... Items>
+inline bool WaitAll(const std::chrono::duration<Rep, Period>& timeout_duration,
+                    QEventLoop::ProcessEventsFlags flags,
+                    const Items&... items) {
+  return WaitAll(
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          timeout_duration)
+          .count(),
+      flags, items...);
+}
 }  // namespace KtUtils
 
 #endif  // __cplusplus
@@ -0,0 +1,51 @@
+#ifndef KTUTILS_GUIDISPATCHER_HPP
+#define KTUTILS_GUIDISPATCHER_HPP
+
+#include "Global.hpp"
+
+namespace KtUtils {
+/**
+ * \brief Batched cross-thread invoker, replacement of
+ *        QMetaObject::invokeMethod(..., Qt::QueuedConnection) for high
+ *        frequency updates.
+ *
+ * Functions are posted into a lock free MPSC queue from any thread, and run
+ * in dispatcher's thread in batches: one posted event per batch instead of
+ * one per function. With a frame interval, batches run at most once per
+ * interval.
+ *
+ * Functions posted with a key are coalesced: in each batch, only the latest
+ * function of a key runs, at the position it's posted.
+ */
+class KTUTILS_EXPORT GuiDispatcher : public QObject {
+  Q_OBJECT
+
+ public:
+  /** \brief Dispatcher runs functions in the thread it lives in. */
+  explicit GuiDispatcher(QObject* parent = nullptr);
+  ~GuiDispatcher() override;
+
+  /** \brief Dispatcher in the thread of QCoreApplication. */
+  static GuiDispatcher* instance();
+
+  /** \brief Run fn in dispatcher's thread, thread safe and lock free. */
+  void post(std::function<void(void)> fn);
+  /** \brief Run fn in dispatcher's thread, replace functions of same key
+   *         which are not run yet. */
+  void post(quint64 key, std::function<void(void)> fn);
+
+  /** \brief Minimum interval between batches in milliseconds, 0 (default)
+   *         runs a batch once per event loop iteration. */
+  int frameInterval() const;
+  void setFrameInterval(int interval_milliseconds);
+
+ protected:
+  bool event(QEvent* event) override;
+
+ private:
+  struct Private;
+  QScopedPointer<Private> d;
+};
+}  // namespace KtUtils
+
+#endif  // KTUTILS_GUIDISPATCHER_HPP
@@ -0,0 +1,56 @@
+#ifndef KTUTILS_HISTOGRAM_HPP
+#define KTUTILS_HISTOGRAM_HPP
+
+#include <atomic>
+#include "Global.hpp"
+
+namespace KtUtils {
+/**
+ * \brief Lock free histogram with log-linear buckets(HDR style), cheap enough
+ *        to record in hot paths from any thread.
+ *
+ * Values below 16 are counted exactly, larger values are counted in 16
+ * sub-buckets per power of 2, so relative error is less than 6.25%.
+ */
+class KTUTILS_EXPORT Histogram {
+ public:
+  static constexpr int kSubBucketCount = 16;
+  static constexpr int kBucketCount = 60 * kSubBucketCount;
+
+  Histogram();
+  // Copy is a snapshot, concurrent records may be partially included.
+  Histogram(const Histogram& other);
+  Histogram& operator=(const Histogram& other);
+
+  // Record a non-negative value, e.g. duration in nanoseconds.
+  void record(qint64 value);
+  // Merge all values recorded in other histogram.
+  void merge(const Histogram& other);
+  void reset();
+
+  quint64 count() const;
+  qint64 min() const;
+  qint64 max() const;
+  double mean() const;
+  /** \brief Lower bound of the bucket where given percentile(0 ~ 100) lays
+   *         in, or 0 if empty. */
+  qint64 percentile(double percentile) const;
+
+  /** \brief Summary and non-empty buckets in json:
+   *  {"count", "min", "max", "mean", "p50", "p90", "p99", "p999",
+   *   "buckets": [[lower bound, count], ...]} */
+  QJsonObject toJson() const;
+
+  static int bucketIndex(qint64 value);
+  static qint64 bucketLowerBound(int index);
+
+ private:
+  std::atomic<quint64> buckets[kBucketCount];
+  std::atomic<quint64> total;
+  std::atomic<qint64> sum;
+  std::atomic<qint64> minimum;
+  std::atomic<qint64> maximum;
+};
+}  // namespace KtUtils
+
+#endif  // KTUTILS_HISTOGRAM_HPP
@@ -2,6 +2,7 @@
 #define KTUTILS_ICONHELPER_HPP
 
 #include "Global.hpp"
+#include "Histogram.hpp"
 
 namespace KtUtils {
 /**
@@ -2062,6 +2063,48 @@ class KTUTILS_EXPORT IconHelper : public QObject {
   static QIcon icon(Icon iconType, const QColor& color = Qt::white,
                     bool cached = true);
 
+  /**
+   * \brief Generate QPixmap for given icon with an overlay icon placed at the
+   *        corner, e.g. a warning triangle as status badge.
+   * \note Composed result is cached as a whole, reuse it for repeated rows
+   *       instead of composing base and overlay in each paint.
+   * \param iconType      Enum value for base icon.
+   * \param overlayType   Enum value for overlay icon, rendered in half size.
+   * \param size          Pixel size for generated image.
+   * \param color         Fill color of base icon.
+   * \param overlayColor  Fill color of overlay icon.
+   * \param corner        Corner to place the overlay.
+   * \param cached        Cache the generated pixmap, return it next time.
+   * \return              Composed QPixmap with given size.
+   * \sa pixmap
+   */
+  static QPixmap composite(Icon iconType, Icon overlayType, int size = 16,
+                           const QColor& color = Qt::white,
+                           const QColor& overlayColor = Qt::red,
+                           Qt::Corner corner = Qt::BottomRightCorner,
+                           bool cached = true);
+
+  /**
+   * \brief Generate QPixmap for given icon with a text badge placed at the
+   *        corner, e.g. unread count.
+   * \param iconType    Enum value for base icon.
+   * \param text        Text in the badge, keep it short.
+   * \param size        Pixel size for generated image.
+   * \param color       Fill color of base icon.
+   * \param textColor   Color of badge text.
+   * \param badgeColor  Background color of the badge.
+   * \param corner      Corner to place the badge.
+   * \param cached      Cache the generated pixmap, return it next time.
+   * \return            Composed QPixmap with given size.
+   * \sa pixmap
+   */
+  static QPixmap composite(Icon iconType, const QString& text, int size = 16,
+                           const QColor& color = Qt::white,
+                           const QColor& textColor = Qt::white,
+                           const QColor& badgeColor = Qt::red,
+                           Qt::Corner corner = Qt::TopRightCorner,
+                           bool cached = true);
+
   // Enumeration for font files
   enum Font { Brand, Regular, Solid };
   /** \brief
@@ -2108,6 +2151,109 @@ class KTUTILS_EXPORT IconHelper : public QObject {
     widget->setProperty("icon", icon(fontType, ch, color, weight, cached));
   }
 
+  /**
+   * \brief Animation styles comes from Font Awesome.
+   *        Spin:  Continuous rotation, one round in 2 seconds(fa-spin).
+   *        Pulse: Rotation in 8 steps, one round in 1 second(fa-spin-pulse).
+   */
+  enum Animation { Spin, Pulse };
+
+  /** \brief Count of pre-rendered frames for given animation style. */
+  static int animationFrameCount(Animation animation);
+
+  /**
+   * \brief Generate a horizontal strip of all rotation frames for given icon,
+   *        frame i is located at QRect(i * size, 0, size, size).
+   * \note Strips are rendered only once for each (icon, size, color,
+   *       animation), and cached for all animated icons.
+   * \param iconType  Enum value for wanted icon.
+   * \param size      Pixel size for each frame.
+   * \param color     Fill color of the icon.
+   * \param animation Animation style.
+   * \return          Generated strip with animationFrameCount() frames.
+   * \sa animationFrame, SetAnimatedIcon
+   */
+  static QPixmap animationStrip(Icon iconType, int size = 16,
+                                const QColor& color = Qt::white,
+                                Animation animation = Spin);
+
+  /**
+   * \brief Get frame at current time of the shared animation clock, all
+   *        animated icons with same animation style are in step.
+   *
+   * Call it in paintEvent of widgets registered by StartAnimation().
+   * \sa animationStrip, StartAnimation
+   */
+  static QPixmap animationFrame(Icon iconType, int size = 16,
+                                const QColor& color = Qt::white,
+                                Animation animation = Spin);
+
+  /**
+   * \brief Set animated icon to given widget, "icon" property of the widget
+   *        is updated by the shared animation clock while it is visible.
+   * \param widget    Widget to be set icon for.
+   * \param iconType  Enum value for wanted icon.
+   * \param size      Pixel size for generated frames.
+   * \param color     Fill color of the icon.
+   * \param animation Animation style.
+   * \sa StopAnimation
+   */
+  static void SetAnimatedIcon(QWidget* widget, Icon iconType, int size = 16,
+                              const QColor& color = Qt::white,
+                              Animation animation = Spin);
+
+  /**
+   * \brief Repaint given widget by the shared animation clock while it is
+   *        visible, draw animationFrame() in its paintEvent.
+   * \sa StopAnimation
+   */
+  static void StartAnimation(QWidget* widget, Animation animation = Spin);
+
+  /** \brief Stop animation started by SetAnimatedIcon or StartAnimation. */
+  static void StopAnimation(QWidget* widget);
+
+  /** \brief Counters of one internal cache. */
+  struct CacheStatistics {
+    QString name;
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 evictions = 0;
+    qint64 bytes = 0;  // Estimated pixel memory held by the cache.
+    int entries = 0;
+  };
+
+  /** \brief Snapshot of cache and rendering statistics. */
+  struct Statistics {
+    QVector<CacheStatistics> caches;
+    Histogram parseTime;      // Nanoseconds to load and parse each svg.
+    Histogram rasterizeTime;  // Nanoseconds to rasterize each pixmap.
+    // Most requested cache keys, with request count in descending order.
+    QVector<QPair<QString, quint64>> topKeys;
+
+    /** \brief Dump statistics into json, e.g. for logging in production. */
+    QJsonObject toJson() const;
+  };
+
+  /**
+   * \brief Collect statistics of all caches and rendering time.
+   * \note Counters are atomic and always enabled, collecting them is cheap,
+   *       but building topKeys walks through all cache entries.
+   * \param topCount Count of most requested keys to collect.
+   * \sa resetStatistics
+   */
+  static Statistics statistics(int topCount = 10);
+  /** \brief Reset all counters and histograms, cached items are kept. */
+  static void resetStatistics();
+
+  /**
+   * \brief Set memory limit in bytes for each cache, oldest items are evicted
+   *        when exceeded. 0 means unlimited, which is the default.
+   */
+  static void setCacheLimit(qint64 bytes);
+  static qint64 cacheLimit();
+  /** \brief Drop all cached pixmaps and icons. */
+  static void clearCache();
+
  private:
   IconHelper() = default;
   ~IconHelper() = default;
@@ -14,6 +14,18 @@ namespace Json {
 QList<QStandardItem*> KTUTILS_EXPORT toStandardItem(const QJsonValue& json,
                                                     const QString& name = {});
 
+/** \brief Generate QStandardItem tree from give json in parallel.
+ *
+ * Subtrees with at least parallel_threshold nodes are split, their children
+ * are converted concurrently by threads of pool and the calling thread, then
+ * joined in order by the calling thread. Result is the same as
+ * toStandardItem(json, name).
+ *  \param pool  Thread pool to help, QThreadPool::globalInstance() if
+ *               nullptr. */
+QList<QStandardItem*> KTUTILS_EXPORT
+toStandardItem(const QJsonValue& json, const QString& name,
+               int parallel_threshold, QThreadPool* pool = nullptr);
+
 /** \brief Generate json value from QStandardItem tree.
  *  \param col0 Item at column 0, contains item name and children.
  *  \param col1 Item at column 1, contains item value.
@@ -24,6 +36,117 @@ QList<QStandardItem*> KTUTILS_EXPORT toStandardItem(const QJsonValue& json,
 QJsonValue KTUTILS_EXPORT fromStandardItem(QStandardItem* col0,
                                            QStandardItem* col1 = nullptr);
 
+/**
+ * \brief Parse json document from file, without copying the whole file into
+ *        memory.
+ *
+ * File is mapped into memory and parsed in place, peak memory is the parsed
+ * document only.
+ *  \param errorString  Set to the reason if failed to read or parse.
+ *  \return Null document if failed.
+ */
+KTUTILS_EXPORT QJsonDocument fromFile(const QString& path,
+                                      QString* errorString = nullptr);
+/** \brief Parse json document from current position to the end of device.
+ *
+ * Maps QFile and QSaveFile like fromFile(), reads other devices in chunks
+ * into a single buffer. */
+KTUTILS_EXPORT QJsonDocument fromDevice(QIODevice& device,
+                                        QString* errorString = nullptr);
+
+/**
+ * \brief Read only tree model over a json value, with the same two columns
+ *        and roles as toStandardItem().
+ *
+ * Model keeps the json value and creates nodes only for rows a view has
+ * fetched, children of objects and arrays are fetched in batches through
+ * canFetchMore()/fetchMore(). Opening huge documents costs memory only for
+ * the rows shown.
+ */
+class KTUTILS_EXPORT Model : public QAbstractItemModel {
+  Q_OBJECT
+
+ public:
+  explicit Model(QObject* parent = nullptr);
+  ~Model() override;
+
+  /** \brief Reset model with a single top level row named `name`, like
+   *         appending the row of toStandardItem(json, name). */
+  void setJson(const QJsonValue& json, const QString& name = {});
+  QJsonValue json() const;
+  /** \brief Json value of the row of index. */
+  QJsonValue value(const QModelIndex& index) const;
+
+  QModelIndex index(int row, int column,
+                    const QModelIndex& parent = {}) const override;
+  QModelIndex parent(const QModelIndex& index) const override;
+  int rowCount(const QModelIndex& parent = {}) const override;
+  int columnCount(const QModelIndex& parent = {}) const override;
+  bool hasChildren(const QModelIndex& parent = {}) const override;
+  QVariant data(const QModelIndex& index,
+                int role = Qt::DisplayRole) const override;
+  bool canFetchMore(const QModelIndex& parent) const override;
+  void fetchMore(const QModelIndex& parent) override;
+
+ private:
+  struct Private;
+  QScopedPointer<Private> d;
+};
+
+/** \brief Handle of loadAsync(), parented to the model. */
+class KTUTILS_EXPORT LoadTask : public QObject {
+  Q_OBJECT
+
+ public:
+  /** \brief Cancel loading if not finished, background work stops at its
+   *         next check. */
+  ~LoadTask() override;
+
+  /** \brief Stop loading before parsing, at next chunk read from an unmapped
+   *         file, or before next row is built. */
+  void cancel();
+  bool isCanceled() const;
+  bool isFinished() const;
+  /** \brief Reason of failure, empty if succeeded or canceled. */
+  QString errorString() const;
+  /** \brief Result is true if document is loaded into model. */
+  QFuture<bool> future() const;
+
+  qint64 bytesRead() const;
+  /** \brief Json values converted into rows, always 0 for Json::Model. */
+  qint64 nodesBuilt() const;
+
+ Q_SIGNALS:
+  void progress(qint64 bytesRead, qint64 nodesBuilt);
+  void finished(bool success);
+
+ private:
+  friend class LoadTaskWorker;
+  explicit LoadTask(QObject* parent);
+  struct Private;
+  std::shared_ptr<Private> d;
+};
+
+/**
+ * \brief Load json file in background into model, as the top level row named
+ *        by file name, like appending toStandardItem(json, name).
+ *
+ * File is parsed by fromFile(), and rows are built by
+ * TaskQueue::globalInstance(), then appended to model in batches, so the
+ * rows appear progressively while the thread of model stays responsive.
+ * Values with many nodes are appended as an empty row first, followed by
+ * batches of rows of their children.
+ * The row is removed if loading fails or is canceled. Must be called in the
+ * thread of model.
+ * \return Handle of the loading, or nullptr if model is nullptr.
+ */
+KTUTILS_EXPORT LoadTask* loadAsync(const QString& path,
+                                   QStandardItemModel* model);
+/** \overload loadAsync
+ *  Read and parse in background, then Model::setJson(), which builds rows
+ *  lazily. */
+KTUTILS_EXPORT LoadTask* loadAsync(const QString& path, Model* model);
+
 // QSettings::registerFormat
 KTUTILS_EXPORT bool settingsReadFunc(QIODevice& device,
                                      QSettings::SettingsMap& map);
@@ -4,9 +4,20 @@
 
 #include "Global.hpp"
 #include "AnchorWidget.hpp"
+#include "Coroutine.hpp"
+#include "Debounce.hpp"
+#include "Executor.hpp"
+#include "GuiDispatcher.hpp"
+#include "Histogram.hpp"
 #include "IconHelper.hpp"
 #include "Json.hpp"
+#include "Logging.hpp"
+#include "LoopMonitor.hpp"
 #include "Settings.hpp"
+#include "TaskQueue.hpp"
+#include "TimerWheel.hpp"
+#include "Trace.hpp"
+#include "WaitTrace.hpp"
 
 #endif  // __cplusplus
 #endif  // KTUTILS_KTUTILS_HPP
@@ -0,0 +1,159 @@
+#ifndef KTUTILS_LOGGING_HPP
+#define KTUTILS_LOGGING_HPP
+
+#include "Global.hpp"
+
+/**
+ * \brief Log with a literal format of QString::arg() placeholders, e.g.
+ *        KTUTILS_LOG(QtWarningMsg, "Parse error at %1: %2", pos, message);
+ *
+ * With async message handler installed, arguments are queued in binary and
+ * formatted by background thread, or written as is by BinaryLogSink. Otherwise
+ * message is formatted immediately and passed to Qt's message handler.
+ * Arguments must be builtin types of QVariant which can be streamed.
+ */
+#define KTUTILS_LOG(type, ...)                                 \
+  ::KtUtils::Log(type, QT_MESSAGELOG_FILE, QT_MESSAGELOG_LINE, \
+                 QT_MESSAGELOG_FUNC, __VA_ARGS__)
+
+namespace KtUtils {
+/**
+ * \brief A message with its context. Strings of context are kept as pointers
+ *        to strings living until exit, literals of KTUTILS_LOG or copies of
+ *        QMessageLogContext interned by the async message handler.
+ */
+struct KTUTILS_EXPORT LogRecord {
+  QtMsgType type = QtDebugMsg;
+  qint64 timestamp = 0;  // Nanoseconds since epoch.
+  quintptr thread = 0;   // QThread::currentThreadId() of logging thread.
+  const char* category = nullptr;
+  const char* file = nullptr;
+  int line = 0;
+  const char* function = nullptr;
+  QString message;
+  // Set by KTUTILS_LOG instead of message, QVariant of each argument in
+  // QDataStream.
+  const char* format = nullptr;
+  QByteArray arguments;
+
+  /** \brief Message, or format with arguments applied. */
+  QString text() const;
+};
+
+/** \brief Destination of log records, only called by one thread at a time. */
+class KTUTILS_EXPORT LogSink {
+ public:
+  virtual ~LogSink();
+  virtual void write(const LogRecord& record) = 0;
+  /** \brief Called after each batch of records. */
+  virtual void flush();
+
+  /** \brief "yyyy-MM-dd hh:mm:ss.zzz type [thread] category: message
+   *         (file:line, function)" */
+  static QString format(const LogRecord& record);
+};
+
+/** \brief Writes formatted records into a stdio stream. */
+class KTUTILS_EXPORT TextLogSink : public LogSink {
+ public:
+  explicit TextLogSink(FILE* stream = stderr);
+  void write(const LogRecord& record) override;
+  void flush() override;
+
+ private:
+  FILE* stream;
+};
+
+/**
+ * \brief Writes records into a compact binary file, decoded by KtLogDecode
+ *        tool or BinaryLogReader.
+ *
+ * Strings of context and formats are written once and referenced by id, and
+ * arguments of KTUTILS_LOG are written without formatting. Records of
+ * qDebug(), qWarning() etc. arrive formatted by Qt and are written as text,
+ * so only KTUTILS_LOG call sites save the cost of formatting.
+ */
+class KTUTILS_EXPORT BinaryLogSink : public LogSink {
+ public:
+  /** \brief Truncate and write into file at path. */
+  explicit BinaryLogSink(const QString& path);
+  ~BinaryLogSink() override;
+  bool isOpen() const;
+  void write(const LogRecord& record) override;
+  void flush() override;
+
+ private:
+  struct Private;
+  QScopedPointer<Private> d;
+};
+
+/** \brief Reads records written by BinaryLogSink. */
+class KTUTILS_EXPORT BinaryLogReader {
+ public:
+  explicit BinaryLogReader(QIODevice* device);
+  ~BinaryLogReader();
+  /** \brief Whether header of device is valid. */
+  bool isValid() const;
+  /** \brief Read next record, strings of it are owned by the reader.
+   *  \return false at end of device or on corrupted data. */
+  bool read(LogRecord* record);
+
+ private:
+  struct Private;
+  QScopedPointer<Private> d;
+};
+
+/**
+ * \brief Install a Qt message handler which queues records into a lock free
+ *        ring buffer of logging thread, and writes them into sink from a
+ *        background thread.
+ *
+ * Records of all threads are written in order of timestamp within each
+ * batch. Records are dropped if a ring buffer is full, and the count of them
+ * is logged later. Fatal messages flush queued records and are written
+ * synchronously before the application aborts.
+ * \param sink      Takes ownership, TextLogSink of stderr if nullptr.
+ * \param capacity  Records in each thread's ring buffer, rounded up to a power
+ *                  of 2.
+ */
+KTUTILS_EXPORT void installAsyncMessageHandler(
+    std::unique_ptr<LogSink> sink = nullptr, int capacity = 4096);
+/** \brief Write all queued records, stop background thread and restore
+ *         previous message handler. Waits for threads in the handler, records
+ *         they queue meanwhile may be lost. */
+KTUTILS_EXPORT void uninstallAsyncMessageHandler();
+/** \brief Block until records queued before it are written. */
+KTUTILS_EXPORT void flushAsyncMessages();
+/** \brief Count of records dropped since installed. */
+KTUTILS_EXPORT quint64 droppedAsyncMessages();
+
+/** \brief Log arguments in binary, called by KTUTILS_LOG. */
+KTUTILS_EXPORT void LogArguments(QtMsgType type, const char* file, int line,
+                                 const char* function, const char* format,
+                                 QByteArray arguments);
+
+/* ================ Definition ================ */
+template <typename T>
+inline QVariant LogArgument(const T& value) {
+  return QVariant::fromValue(value);
+}
+inline QVariant LogArgument(const char* value) {
+  return QString::fromUtf8(value);
+}
+
+template <typename... Args>
+inline void Log(QtMsgType type, const char* file, int line,
+                const char* function, const char* format,
+                const Args&... args) {
+  QByteArray arguments;
+  {
+    QDataStream stream(&arguments, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_12);
+    const int expand[] = {0, ((stream << LogArgument(args)), 0)...};
+    Q_UNUSED(expand)
+  }
+  LogArguments(type, file, line, function, format, std::move(arguments));
+}
+}  // namespace KtUtils
+
+#endif  // KTUTILS_LOGGING_HPP
@@ -0,0 +1,76 @@
+#ifndef KTUTILS_LOOPMONITOR_HPP
+#define KTUTILS_LOOPMONITOR_HPP
+
+#include "Histogram.hpp"
+
+namespace KtUtils {
+/**
+ * \brief Event loop stall detector of the thread it lives in.
+ *
+ * Measures with low overhead, so it can be left on in production:
+ * - Iteration time: from dispatcher wakes up until it blocks again, longer
+ *   iteration means the thread is not responsive for that time.
+ * - Dispatch latency: how long a posted heartbeat probe waits in the queue.
+ *
+ * Time of each event is measured from its delivery to the next one, when an
+ * iteration exceeds stall threshold, stallDetected() reports the slowest
+ * event of that iteration. Event timing relies on Qt 5's private
+ * QInternal::registerCallback hook.
+ *
+ * Monitor may be stopped or destroyed in another thread while monitored
+ * thread is blocked or finished, its state is released by monitored thread
+ * on its next event.
+ */
+class KTUTILS_EXPORT LoopMonitor : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit LoopMonitor(QObject* parent = nullptr);
+  ~LoopMonitor() override;
+
+  /** \brief Start monitoring current thread, which must be the thread of
+   *         monitor. Only one monitor can be active in a thread. */
+  void start();
+  void stop();
+  bool isActive() const;
+
+  /** \brief Iterations longer than it are reported, 100ms by default. */
+  double stallThreshold() const;
+  void setStallThreshold(double threshold_milliseconds);
+  /** \brief Interval of posting heartbeat probes, 100ms by default. */
+  int probeInterval() const;
+  void setProbeInterval(int interval_milliseconds);
+
+  /** \brief Nanoseconds of each event loop iteration. */
+  const Histogram& iterationTime() const;
+  /** \brief Nanoseconds heartbeat probes wait in event queue. */
+  const Histogram& dispatchLatency() const;
+  /** \brief Nanoseconds of longest iteration. */
+  qint64 longestIteration() const;
+  void reset();
+
+  /** \brief {"iterationTime": Histogram::toJson(), "dispatchLatency": ...,
+   *          "longestIteration": nanoseconds} */
+  QJsonObject toJson() const;
+
+ Q_SIGNALS:
+  /**
+   * \brief Emitted after a stalled iteration.
+   * \param duration_milliseconds Length of the iteration.
+   * \param eventType     Type of the slowest event in the iteration.
+   * \param receiverClass Class name of receiver of the slowest event.
+   */
+  void stallDetected(double duration_milliseconds, int eventType,
+                     const QString& receiverClass);
+
+ protected:
+  bool event(QEvent* event) override;
+
+ private:
+  friend class LoopMonitorHook;
+  struct Private;
+  std::shared_ptr<Private> d;
+};
+}  // namespace KtUtils
+
+#endif  // KTUTILS_LOOPMONITOR_HPP
@@ -0,0 +1,62 @@
+#ifndef KTUTILS_TASKQUEUE_HPP
+#define KTUTILS_TASKQUEUE_HPP
+
+#include "Global.hpp"
+
+namespace KtUtils {
+/**
+ * \brief Thread safe FIFO queue of tasks, which can be run by pool threads and
+ *        by threads waiting in Wait()/WaitFor() at the same time.
+ *
+ * Each task comes with an estimated run time, so that waiting threads only
+ * take tasks short enough to keep their own deadline. Tasks of unknown run
+ * time are never taken by waits with a bound.
+ */
+class KTUTILS_EXPORT TaskQueue {
+ public:
+  using Task = std::function<void(void)>;
+
+  /** \param pool  Run one queued task in the pool for each post(), or only
+   *               run tasks by runOne() if nullptr. */
+  explicit TaskQueue(QThreadPool* pool = nullptr);
+  virtual ~TaskQueue();
+  TaskQueue(const TaskQueue&) = delete;
+  TaskQueue& operator=(const TaskQueue&) = delete;
+
+  /** \brief Queue drained by QThreadPool::globalInstance(). */
+  static TaskQueue* globalInstance();
+
+  /**
+   * \brief Queue a task, thread safe.
+   * \param estimate_milliseconds Expected run time, infinity if unknown,
+   *                              which is only taken by runOne() without
+   *                              bound and by pool threads.
+   */
+  virtual void post(Task task, double estimate_milliseconds =
+                                   std::numeric_limits<double>::infinity());
+  /**
+   * \brief Take the oldest task expected to finish in given time, and run it
+   *        in current thread.
+   * \return false if no such task.
+   */
+  virtual bool runOne(double max_estimate_milliseconds =
+                          std::numeric_limits<double>::infinity());
+  virtual int pendingCount() const;
+
+ protected:
+  /** \brief Tag of the constructor for subclasses keeping their own tasks. */
+  struct CustomQueue {};
+  /** \brief Queue of base class is not allocated, subclass overrides post(),
+   *         runOne() and pendingCount(). */
+  explicit TaskQueue(CustomQueue);
+
+ private:
+  friend class TaskQueueRunnable;
+  struct Private;
+  // Shared with runnables started in pool, which may outlive the queue, null
+  // if constructed with CustomQueue.
+  std::shared_ptr<Private> d;
+};
+}  // namespace KtUtils
+
+#endif  // KTUTILS_TASKQUEUE_HPP
@@ -0,0 +1,77 @@
+#ifndef KTUTILS_TIMERWHEEL_HPP
+#define KTUTILS_TIMERWHEEL_HPP
+
+#include "Global.hpp"
+
+namespace KtUtils {
+/**
+ * \brief Hierarchical timer wheel for large amount of concurrent deadlines.
+ *
+ * Timers are kept in 4 levels of 64 slots, schedule and cancel cost O(1)
+ * regardless of how many timers are pending. All timers of a wheel share one
+ * QTimer, which only runs while timers are pending and sleeps until the next
+ * non-empty slot.
+ *
+ * A wheel belongs to the thread it is created in, it is NOT thread safe, and
+ * callbacks are invoked by that thread's event loop. Timers never expire
+ * earlier than requested, and may be late for up to one tick.
+ */
+class KTUTILS_EXPORT TimerWheel {
+ public:
+  /** \brief Identifier of a scheduled timer, 0 is never used. */
+  using TimerId = quint64;
+
+  /** \param resolution_milliseconds Length of a tick, at least 1. */
+  explicit TimerWheel(int resolution_milliseconds = 1);
+  ~TimerWheel();
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /** \brief Wheel of current thread, created on first use with 1ms
+   *         resolution, and destroyed when the thread exits. */
+  static TimerWheel* instance();
+  /** \brief Guarded handle of instance(), expires when the thread exits. */
+  static std::weak_ptr<TimerWheel> instanceHandle();
+
+  int resolution() const;
+  /** \brief Change tick length, only allowed while no timer is pending. */
+  void setResolution(int resolution_milliseconds);
+
+  /**
+   * \brief Invoke callback once after given interval.
+   * \return Identifier to cancel the timer.
+   */
+  TimerId schedule(double timeout_milliseconds,
+                   std::function<void(void)> callback);
+  /** \overload schedule */
+  template <class Rep, class Period>
+  TimerId schedule(const std::chrono::duration<Rep, Period>& timeout_duration,
+                   std::function<void(void)> callback);
+  /** \brief Invoke callback once when deadline expired. */
+  TimerId schedule(const QDeadlineTimer& deadline,
+                   std::function<void(void)> callback);
+
+  /** \return false if the timer already expired or been canceled. */
+  bool cancel(TimerId id);
+  bool isPending(TimerId id) const;
+  int pendingCount() const;
+
+ private:
+  struct Private;
+  QScopedPointer<Private> d;
+};
+
+/* ================ Definition ================ */
+template <class Rep, class Period>
+inline TimerWheel::TimerId TimerWheel::schedule(
+    const std::chrono::duration<Rep, Period>& timeout_duration,
+    std::function<void(void)> callback) {
+  return schedule(
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          timeout_duration)
+          .count(),
+      std::move(callback));
+}
+}  // namespace KtUtils
+
+#endif  // KTUTILS_TIMERWHEEL_HPP
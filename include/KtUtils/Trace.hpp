@@ -0,0 +1,65 @@
+#ifndef KTUTILS_TRACE_HPP
+#define KTUTILS_TRACE_HPP
+
+#include "Global.hpp"
+
+#define KTUTILS_TRACE_CONCAT_IMPL(a, b) a##b
+#define KTUTILS_TRACE_CONCAT(a, b) KTUTILS_TRACE_CONCAT_IMPL(a, b)
+
+/**
+ * \brief Record current scope as a span named by given string literal, e.g.
+ *        KTUTILS_TRACE_SCOPE("IconHelper::GetRenderer");
+ *
+ * Compiled out unless KTUTILS_ENABLE_TRACING is defined, by CMake option
+ * KTUTILS_TRACING.
+ */
+#ifdef KTUTILS_ENABLE_TRACING
+#define KTUTILS_TRACE_SCOPE(name) \
+  const ::KtUtils::TraceScope KTUTILS_TRACE_CONCAT(ktTrace_, __LINE__)(name)
+#else
+#define KTUTILS_TRACE_SCOPE(name) static_cast<void>(0)
+#endif
+
+namespace KtUtils {
+/** \brief Records span of its lifetime into buffer of current thread, use
+ *         KTUTILS_TRACE_SCOPE() instead. */
+class KTUTILS_EXPORT TraceScope {
+ public:
+  explicit TraceScope(const char* name);
+  ~TraceScope();
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name;
+  qint64 start;
+};
+
+/**
+ * \brief Spans recorded by KTUTILS_TRACE_SCOPE().
+ *
+ * Each thread records into its own buffer, which keeps latest spans when
+ * full. Buffers are kept after threads exit, until clear().
+ */
+class KTUTILS_EXPORT Trace {
+ public:
+  /** \brief Pause or resume recording, enabled by default. */
+  static void setEnabled(bool enabled);
+  static bool isEnabled();
+
+  /** \brief Spans kept for each thread, 65536 by default. Applies to buffers
+   *         created later. */
+  static int bufferCapacity();
+  static void setBufferCapacity(int capacity);
+  static void clear();
+
+  /** \brief All recorded spans in Chrome trace event format:
+   *         {"traceEvents": [{"ph": "X", ...}, ...]} */
+  static QJsonObject toChromeTrace();
+  /** \brief Write toChromeTrace() into file, which can be opened by
+   *         chrome://tracing or Perfetto. */
+  static bool writeChromeTrace(const QString& path);
+};
+}  // namespace KtUtils
+
+#endif  // KTUTILS_TRACE_HPP
@@ -0,0 +1,80 @@
+#ifndef KTUTILS_WAITTRACE_HPP
+#define KTUTILS_WAITTRACE_HPP
+
+#include "Global.hpp"
+
+/**
+ * \brief Tag waits in current scope with the file, line and function here,
+ *        e.g.
+ *        KTUTILS_WAIT_SITE();
+ *        WaitFor(100, QEventLoop::AllEvents, [&] { return done; });
+ */
+#define KTUTILS_WAIT_SITE()                   \
+  const ::KtUtils::WaitSiteScope ktWaitSite_( \
+      QT_MESSAGELOG_FILE, QT_MESSAGELOG_LINE, QT_MESSAGELOG_FUNC)
+
+namespace KtUtils {
+/** \brief Source location of waits, like QMessageLogContext. */
+struct WaitSite {
+  const char* file = nullptr;
+  int line = 0;
+  const char* function = nullptr;
+};
+
+/** \brief Sets wait site of current thread while alive, use
+ *         KTUTILS_WAIT_SITE() instead. */
+class KTUTILS_EXPORT WaitSiteScope {
+ public:
+  WaitSiteScope(const char* file, int line, const char* function);
+  ~WaitSiteScope();
+  WaitSiteScope(const WaitSiteScope&) = delete;
+  WaitSiteScope& operator=(const WaitSiteScope&) = delete;
+
+ private:
+  WaitSite site;
+  const WaitSite* previous;
+};
+
+/** \brief Accumulated cost of waits of a site. */
+struct WaitSiteStatistics {
+  QString site;  // "file:line function", or wait kind if not tagged.
+  quint64 count = 0;
+  quint64 events = 0;  // Events delivered in waiting thread during waits.
+  quint64 predicateCalls = 0;
+  qint64 totalTime = 0;  // Nanoseconds.
+  qint64 maxTime = 0;    // Nanoseconds.
+  int maxDepth = 0;      // Deepest nesting level, 1 for outermost waits.
+};
+
+/**
+ * \brief Accounting of nested event loops run by Wait, WaitFor, WaitUntil and
+ *        WaitGroup.
+ *
+ * Nesting depth is always tracked. When enabled, each wait is accounted to
+ * the site set by KTUTILS_WAIT_SITE() in its thread, and recorded as a span of
+ * the trace, which can be loaded by chrome://tracing or Perfetto.
+ */
+class KTUTILS_EXPORT WaitTrace {
+ public:
+  static void setEnabled(bool enabled);
+  static bool isEnabled();
+
+  /** \brief Number of waits running in current thread. */
+  static int currentDepth();
+
+  /** \brief Statistics of all sites in all threads, sorted by total time. */
+  static QVector<WaitSiteStatistics> statistics();
+  /** \brief Clear statistics and recorded spans. */
+  static void reset();
+
+  /** \brief Maximum number of spans kept, oldest spans are dropped. 10000 by
+   *         default. */
+  static int traceCapacity();
+  static void setTraceCapacity(int capacity);
+  /** \brief Recorded spans in Chrome trace event format:
+   *         {"traceEvents": [{"ph": "X", ...}, ...]} */
+  static QJsonObject toChromeTrace();
+};
+}  // namespace KtUtils
+
+#endif  // KTUTILS_WAITTRACE_HPP
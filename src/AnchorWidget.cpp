@@ -1,4 +1,5 @@
 #include <KtUtils/AnchorWidget>
+#include <KtUtils/Trace>
 
 Q_DECLARE_METATYPE(QGraphicsLayoutItem*)
 
@@ -83,6 +84,7 @@ bool AnchorWidget::event(QEvent* event) {
 
   switch (event->type()) {
     case QEvent::Resize: {
+      KTUTILS_TRACE_SCOPE("AnchorWidget::resize");
       QResizeEvent* e = static_cast<QResizeEvent*>(event);
       d->layoutWidget->resize(e->size());
       // fitInView(d->layoutWidget);
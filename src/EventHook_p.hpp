@@ -0,0 +1,56 @@
+#pragma once
+#ifndef KTUTILS_EVENTHOOK_P_HPP
+#define KTUTILS_EVENTHOOK_P_HPP
+
+#include <KtUtils/Global.hpp>
+
+namespace KtUtils {
+namespace EventHook {
+// Called by the thread delivering each event, before it is delivered.
+using Callback = void (*)(const QObject* receiver, const QEvent* event);
+
+// Room for LoopMonitor and WaitTrace.
+static constexpr int kMaxCallbacks = 4;
+
+inline std::atomic<Callback>* Callbacks() {
+  static std::atomic<Callback> callbacks[kMaxCallbacks] = {};
+  return callbacks;
+}
+
+// The only QInternal::EventNotifyCallback of KtUtils. It's private API of
+// QtCore, kept in Qt 5 for tools like GammaRay, so it's used only here.
+inline bool Notify(void** data) {
+  const auto receiver = static_cast<const QObject*>(data[0]);
+  const auto event = static_cast<const QEvent*>(data[1]);
+  std::atomic<Callback>* callbacks = Callbacks();
+  for (int i = 0; i < kMaxCallbacks; ++i) {
+    const Callback callback = callbacks[i].load(std::memory_order_acquire);
+    if (!callback) break;
+    callback(receiver, event);
+  }
+  return false;
+}
+
+// Add callback once, callbacks are process wide and never removed, so they
+// should return quickly in threads they don't care.
+inline void Add(Callback callback) {
+  static QBasicMutex mutex;
+  QMutexLocker locker(&mutex);
+  std::atomic<Callback>* callbacks = Callbacks();
+  int i = 0;
+  for (; (i < kMaxCallbacks) && callbacks[i].load(); ++i) {
+    if (callbacks[i].load() == callback) return;
+  }
+  if (Q_UNLIKELY(i == kMaxCallbacks)) {
+    qWarning() << "EventHook::Add: too many callbacks";
+    return;
+  }
+  callbacks[i].store(callback, std::memory_order_release);
+  if (i == 0) {
+    QInternal::registerCallback(QInternal::EventNotifyCallback, &Notify);
+  }
+}
+}  // namespace EventHook
+}  // namespace KtUtils
+
+#endif  // KTUTILS_EVENTHOOK_P_HPP
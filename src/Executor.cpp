@@ -0,0 +1,187 @@
+#include <KtUtils/Executor>
+#include <deque>
+
+namespace KtUtils {
+/* ======================== CancellationToken ======================== */
+CancellationToken::CancellationToken()
+    : d(std::make_shared<WaitCondition>()) {}
+
+void CancellationToken::cancel() { d->notify(); }
+
+bool CancellationToken::isCanceled() const { return d->isNotified(); }
+
+const WaitCondition& CancellationToken::condition() const { return *d; }
+/* ======================== CancellationToken ======================== */
+
+/* ======================== Executor ======================== */
+namespace {
+struct Item {
+  TaskQueue::Task task;
+  double estimate;
+};
+
+// Deque owned by a worker, the owner works at the back and others steal from
+// the front.
+struct WorkerQueue {
+  QMutex mutex;
+  std::deque<Item> items;
+};
+}  // namespace
+
+class ExecutorWorker : public QThread {
+ public:
+  ExecutorWorker(Executor::Private* executor, int index)
+      : executor(executor), index(index) {}
+
+ protected:
+  void run() override;
+
+ private:
+  Executor::Private* executor;
+  int index;
+};
+
+struct Executor::Private {
+  std::vector<std::unique_ptr<WorkerQueue>> queues;
+  std::vector<std::unique_ptr<ExecutorWorker>> workers;
+  std::atomic<int> pending{0};
+  std::atomic<int> sleeping{0};
+  std::atomic<unsigned> next{0};  // Round robin index for external posts.
+  std::atomic<bool> stopping{false};
+  QMutex idleMutex;
+  QWaitCondition idle;
+
+  // Index of current worker thread in this executor, -1 if not a worker.
+  int currentIndex() const;
+
+  void push(int index, Item item) {
+    // Paired with worker which increases sleeping before checking pending.
+    pending.fetch_add(1);
+    {
+      QMutexLocker locker(&queues[index]->mutex);
+      queues[index]->items.push_back(std::move(item));
+    }
+    if (sleeping.load() > 0) {
+      QMutexLocker locker(&idleMutex);
+      idle.wakeOne();
+    }
+  }
+
+  // Pop newest task of worker's own deque with estimate in bound.
+  TaskQueue::Task popBack(int index, double maxEstimate) {
+    WorkerQueue& queue = *queues[index];
+    QMutexLocker locker(&queue.mutex);
+    if (queue.items.empty() || (queue.items.back().estimate > maxEstimate)) {
+      return {};
+    }
+    TaskQueue::Task task = std::move(queue.items.back().task);
+    queue.items.pop_back();
+    pending.fetch_sub(1);
+    return task;
+  }
+
+  // Steal oldest task with estimate in bound from other deques, starting
+  // after given index.
+  TaskQueue::Task steal(int index, double maxEstimate) {
+    const int count = int(queues.size());
+    for (int i = 1; i <= count; ++i) {
+      WorkerQueue& queue = *queues[(index + i) % count];
+      QMutexLocker locker(&queue.mutex);
+      if (queue.items.empty() || (queue.items.front().estimate > maxEstimate)) {
+        continue;
+      }
+      TaskQueue::Task task = std::move(queue.items.front().task);
+      queue.items.pop_front();
+      pending.fetch_sub(1);
+      return task;
+    }
+    return {};
+  }
+};
+
+// Identify worker threads without Q_OBJECT.
+static thread_local const void* currentExecutor = nullptr;
+static thread_local int currentWorker = -1;
+
+int Executor::Private::currentIndex() const {
+  return (currentExecutor == this) ? currentWorker : -1;
+}
+
+void ExecutorWorker::run() {
+  currentExecutor = executor;
+  currentWorker = index;
+  while (!executor->stopping.load()) {
+    static constexpr double kAny = std::numeric_limits<double>::infinity();
+    TaskQueue::Task task = executor->popBack(index, kAny);
+    if (!task) task = executor->steal(index, kAny);
+    if (task) {
+      task();
+      continue;
+    }
+
+    QMutexLocker locker(&executor->idleMutex);
+    executor->sleeping.fetch_add(1);
+    if ((executor->pending.load() == 0) && !executor->stopping.load()) {
+      executor->idle.wait(&executor->idleMutex);
+    }
+    executor->sleeping.fetch_sub(1);
+  }
+}
+
+Executor::Executor(int workerCount)
+    : TaskQueue(CustomQueue()), executor(new Private) {
+  workerCount = qMax(workerCount, 1);
+  for (int i = 0; i < workerCount; ++i) {
+    executor->queues.emplace_back(new WorkerQueue);
+  }
+  for (int i = 0; i < workerCount; ++i) {
+    executor->workers.emplace_back(new ExecutorWorker(executor.data(), i));
+    executor->workers.back()->setObjectName(
+        QStringLiteral("KtUtils::Executor#%1").arg(i));
+    executor->workers.back()->start();
+  }
+}
+
+Executor::~Executor() {
+  {
+    QMutexLocker locker(&executor->idleMutex);
+    executor->stopping.store(true);
+    executor->idle.wakeAll();
+  }
+  for (auto& worker : executor->workers) {
+    worker->wait();
+  }
+}
+
+int Executor::workerCount() const { return int(executor->workers.size()); }
+
+void Executor::post(Task task, double estimate_milliseconds) {
+  if (Q_UNLIKELY(!task)) {
+    qWarning() << "Executor::post: task is empty";
+    return;
+  }
+  int index = executor->currentIndex();
+  if (index < 0) {
+    index = int(executor->next.fetch_add(1) % executor->queues.size());
+  }
+  // Unknown estimate is infinity, not taken by waits with a bound.
+  const double estimate = qIsNaN(estimate_milliseconds)
+                              ? std::numeric_limits<double>::infinity()
+                              : qMax(estimate_milliseconds, 0.0);
+  executor->push(index, Item{std::move(task), estimate});
+}
+
+bool Executor::runOne(double max_estimate_milliseconds) {
+  const int index = executor->currentIndex();
+  Task task = (index >= 0)
+                  ? executor->popBack(index, max_estimate_milliseconds)
+                  : Task();
+  if (!task) task = executor->steal(qMax(index, 0), max_estimate_milliseconds);
+  if (!task) return false;
+  task();
+  return true;
+}
+
+int Executor::pendingCount() const { return executor->pending.load(); }
+/* ======================== Executor ======================== */
+}  // namespace KtUtils
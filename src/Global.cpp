@@ -1,10 +1,134 @@
 ﻿#include <KtUtils/Global>
+#include <KtUtils/TaskQueue>
+#include <KtUtils/TimerWheel>
+#include <atomic>
+#include "WaitTrace_p.hpp"
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 namespace KtUtils {
+// Deadline after given interval, already expired if interval is not positive.
+static QDeadlineTimer DeadlineAfter(double timeout_milliseconds) {
+  if (timeout_milliseconds >=
+      (double(std::numeric_limits<qint64>::max()) / 1e6)) {
+    return QDeadlineTimer(QDeadlineTimer::Forever);
+  }
+  const qint64 nsecs = qint64(qMax(timeout_milliseconds, 0.0) * 1e6);
+  QDeadlineTimer deadline(Qt::PreciseTimer);
+  deadline.setPreciseRemainingTime(nsecs / 1000000000, nsecs % 1000000000,
+                                   Qt::PreciseTimer);
+  return deadline;
+}
+
+// Event dispatcher of current thread, created if not exist yet.
+static QAbstractEventDispatcher* CurrentDispatcher() {
+  if (!QAbstractEventDispatcher::instance()) {
+    QEventLoop loop;  // Constructor creates dispatcher for current thread.
+  }
+  return QAbstractEventDispatcher::instance();
+}
+
+// Whether current thread runs a Qt event loop. If not, predicate waits sleep
+// between checks instead of spinning processEvents().
+static bool HasEventLoop() {
+  const QCoreApplication* app = QCoreApplication::instance();
+  if (!app) return false;
+  const QThread* thread = QThread::currentThread();
+  return (thread == app->thread()) || (thread->loopLevel() > 0);
+}
+
+// Whether current thread has an event dispatcher, which may deliver posted
+// events, timers and socket notifiers of objects living in the thread, even
+// without exec(), e.g. QThreadPool workers. Only threads without one, e.g.
+// std::thread, may block on OS primitives.
+static bool HasEventDispatcher() {
+  return QCoreApplication::instance() &&
+         QAbstractEventDispatcher::instance(QThread::currentThread());
+}
+
+// Block current thread until deadline expired, for threads without event
+// dispatcher.
+static void SleepUntil(const QDeadlineTimer& deadline) {
+  while (!deadline.hasExpired()) {
+    const qint64 nsecs =
+        deadline.isForever() ? 1000000000 : deadline.remainingTimeNSecs();
+    QThread::usleep((unsigned long)(qMax<qint64>(nsecs / 1000, 1)));
+  }
+}
+
+// Default backoff of predicate waits in threads without event loop.
+static constexpr WaitBackoff kThreadBackoff{1, 1.5, 10};
+
+// Process events until deadline expired or stop() returns true, sleep in
+// event dispatcher while no event comes.
+static void ProcessEventsUntil(QDeadlineTimer deadline,
+                               QEventLoop::ProcessEventsFlags flags,
+                               const std::function<bool(void)>& stop) {
+  QEventLoop loop;  // Ensure event dispatcher of current thread.
+  QTimer timer;     // Timer event wakes up the dispatcher at deadline.
+  timer.setSingleShot(true);
+  timer.setTimerType(Qt::PreciseTimer);
+  while (!stop() && !deadline.hasExpired()) {
+    if (!deadline.isForever() && !timer.isActive()) {
+      timer.start(int(qBound<qint64>(0, deadline.remainingTime(),
+                                     std::numeric_limits<int>::max())));
+    }
+    loop.processEvents(flags | QEventLoop::WaitForMoreEvents);
+  }
+}
+
+// Sleep until deadline, processing events if current thread has event
+// dispatcher.
+static void IdleUntil(const QDeadlineTimer& deadline,
+                      QEventLoop::ProcessEventsFlags flags) {
+  if (HasEventDispatcher()) {
+    ProcessEventsUntil(deadline, flags, [] { return false; });
+  } else {
+    SleepUntil(deadline);
+  }
+}
+
+// CPU time used by current thread in nanoseconds, 0 if not supported.
+static qint64 ThreadCpuTime() {
+#if defined(Q_OS_WIN)
+  FILETIME creation, exited, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exited, &kernel,
+                      &user)) {
+    return 0;
+  }
+  auto toNSecs = [](const FILETIME& time) {
+    return qint64((quint64(time.dwHighDateTime) << 32) | time.dwLowDateTime) *
+           100;
+  };
+  return toNSecs(kernel) + toNSecs(user);
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+  timespec time;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) return 0;
+  return qint64(time.tv_sec) * 1000000000 + time.tv_nsec;
+#else
+  return 0;
+#endif
+}
+
 void Wait(const std::function<bool(void)>& isValid,
           QEventLoop::ProcessEventsFlags flags) {
+  if (!HasEventLoop()) {
+    Wait(isValid, flags, kThreadBackoff);
+    return;
+  }
   if (isValid) {
-    while (!isValid()) {
+    WaitScope scope("Wait");
+    auto check = [&isValid, &scope] {
+      ++scope.predicateCalls;
+      return isValid();
+    };
+    while (!check()) {
       QCoreApplication::processEvents(flags, 10);
     }
   }
@@ -12,6 +136,9 @@ void Wait(const std::function<bool(void)>& isValid,
 
 bool WaitFor(double timeout_milliseconds, QEventLoop::ProcessEventsFlags flags,
              const std::function<bool(void)>& isValid) {
+  if (!HasEventLoop()) {
+    return WaitFor(timeout_milliseconds, flags, isValid, kThreadBackoff);
+  }
   QElapsedTimer timer;
   timer.start();
   Wait(
@@ -33,4 +160,383 @@ bool WaitUntil(const QDateTime& timeout_time,
   return WaitFor(QDateTime::currentDateTime().msecsTo(timeout_time), flags,
                  isValid);
 }
+
+/* ======================== WaitBackoff ======================== */
+// Check predicate with growing interval until valid or deadline expired.
+static bool WaitWithBackoff(const std::function<bool(void)>& isValid,
+                            QDeadlineTimer deadline,
+                            QEventLoop::ProcessEventsFlags flags,
+                            const WaitBackoff& backoff,
+                            WaitStatistics* statistics) {
+  WaitScope scope("WaitBackoff");
+  QElapsedTimer timer;
+  timer.start();
+  const qint64 cpuTime = ThreadCpuTime();
+  quint64 predicateCalls = 0;
+  auto check = [&isValid, &predicateCalls] {
+    ++predicateCalls;
+    return isValid();
+  };
+
+  bool valid = false;
+  if (isValid) {
+    valid = check();
+    // Zero intervals or shrinking growth would spin on the predicate.
+    double interval = qMax(backoff.initialInterval, 1.0);
+    const double growthFactor = qMax(backoff.growthFactor, 1.0);
+    const double maxInterval = qMax(backoff.maxInterval, interval);
+    while (!valid && !deadline.hasExpired()) {
+      QDeadlineTimer next = DeadlineAfter(interval);
+      if (next > deadline) next = deadline;
+      IdleUntil(next, flags);
+      valid = check();
+      interval = qMin(interval * growthFactor, maxInterval);
+    }
+  } else {
+    // Nothing to check, just sleep until deadline.
+    IdleUntil(deadline, flags);
+  }
+
+  scope.predicateCalls = predicateCalls;
+  if (statistics) {
+    statistics->predicateCalls = predicateCalls;
+    statistics->cpuTime = ThreadCpuTime() - cpuTime;
+    statistics->elapsedTime = timer.nsecsElapsed();
+  }
+  return valid;
+}
+
+void Wait(const std::function<bool(void)>& isValid,
+          QEventLoop::ProcessEventsFlags flags, const WaitBackoff& backoff,
+          WaitStatistics* statistics) {
+  if (isValid) {
+    WaitWithBackoff(isValid, QDeadlineTimer(QDeadlineTimer::Forever), flags,
+                    backoff, statistics);
+  }
+}
+
+bool WaitFor(double timeout_milliseconds, QEventLoop::ProcessEventsFlags flags,
+             const std::function<bool(void)>& isValid,
+             const WaitBackoff& backoff, WaitStatistics* statistics) {
+  const bool valid =
+      WaitWithBackoff(isValid, DeadlineAfter(timeout_milliseconds), flags,
+                      backoff, statistics);
+  if (isValid) {
+    return valid;
+  } else {
+    return true;
+  }
+}
+
+bool WaitUntil(const QDateTime& timeout_time,
+               QEventLoop::ProcessEventsFlags flags,
+               const std::function<bool(void)>& isValid,
+               const WaitBackoff& backoff, WaitStatistics* statistics) {
+  return WaitFor(QDateTime::currentDateTime().msecsTo(timeout_time), flags,
+                 isValid, backoff, statistics);
+}
+/* ======================== WaitBackoff ======================== */
+
+/* ======================== TaskQueue ======================== */
+// Interval to idle when no task to run, new tasks don't wake up the waiter.
+static constexpr double kHelpIdleInterval = 1;
+
+// Run tasks of queue until valid or deadline expired.
+static bool WaitWithQueue(const std::function<bool(void)>& isValid,
+                          QDeadlineTimer deadline,
+                          QEventLoop::ProcessEventsFlags flags,
+                          TaskQueue& queue, double maxTask) {
+  WaitScope scope("WaitQueue");
+  const bool hasEventDispatcher = HasEventDispatcher();
+  bool stealing = true;
+  auto check = [&isValid, &scope] {
+    ++scope.predicateCalls;
+    return isValid();
+  };
+  while (!(isValid && check())) {
+    if (deadline.hasExpired()) return false;
+
+    if (stealing) {
+      double bound = maxTask;
+      if (!deadline.isForever()) {
+        bound = qMin(bound, deadline.remainingTimeNSecs() / 1e6);
+      }
+      QElapsedTimer timer;
+      timer.start();
+      if (queue.runOne(bound)) {
+        // Estimate is not reliable, stop taking tasks to keep the deadline.
+        if (timer.nsecsElapsed() > (maxTask * 1e6)) stealing = false;
+        if (hasEventDispatcher) QCoreApplication::processEvents(flags);
+        continue;
+      }
+    }
+
+    QDeadlineTimer next = DeadlineAfter(kHelpIdleInterval);
+    if (next > deadline) next = deadline;
+    IdleUntil(next, flags);
+  }
+  return true;
+}
+
+void Wait(const std::function<bool(void)>& isValid,
+          QEventLoop::ProcessEventsFlags flags, TaskQueue& queue,
+          double max_task_milliseconds) {
+  if (isValid) {
+    WaitWithQueue(isValid, QDeadlineTimer(QDeadlineTimer::Forever), flags,
+                  queue, max_task_milliseconds);
+  }
+}
+
+bool WaitFor(double timeout_milliseconds, QEventLoop::ProcessEventsFlags flags,
+             const std::function<bool(void)>& isValid, TaskQueue& queue,
+             double max_task_milliseconds) {
+  const bool valid =
+      WaitWithQueue(isValid, DeadlineAfter(timeout_milliseconds), flags, queue,
+                    max_task_milliseconds);
+  if (isValid) {
+    return valid;
+  } else {
+    return true;
+  }
+}
+/* ======================== TaskQueue ======================== */
+
+/* ======================== WaitCondition ======================== */
+struct WaitCondition::Private {
+  std::atomic<bool> notified{false};
+  QMutex mutex;
+  // Dispatchers of threads waiting for this condition.
+  QVector<QAbstractEventDispatcher*> dispatchers;
+  // Threads without event dispatcher block on it.
+  QWaitCondition sleepers;
+};
+
+WaitCondition::WaitCondition() : d(new Private) {}
+
+WaitCondition::~WaitCondition() {}
+
+void WaitCondition::notify() {
+  d->notified.store(true, std::memory_order_release);
+  QMutexLocker locker(&d->mutex);
+  for (QAbstractEventDispatcher* dispatcher : d->dispatchers) {
+    dispatcher->wakeUp();
+  }
+  d->sleepers.wakeAll();
+}
+
+void WaitCondition::reset() {
+  d->notified.store(false, std::memory_order_release);
+}
+
+bool WaitCondition::isNotified() const {
+  return d->notified.load(std::memory_order_acquire);
+}
+
+// Register dispatcher of current thread into the condition while waiting.
+// Registered before checking the condition, so notification between check
+// and sleep still wakes up the dispatcher.
+class WaitConditionWaiter {
+ public:
+  WaitConditionWaiter(const WaitCondition& condition,
+                      QAbstractEventDispatcher* dispatcher)
+      : d(condition.d.data()), dispatcher(dispatcher) {
+    QMutexLocker locker(&d->mutex);
+    d->dispatchers << dispatcher;
+  }
+
+  ~WaitConditionWaiter() {
+    QMutexLocker locker(&d->mutex);
+    d->dispatchers.removeOne(dispatcher);
+  }
+
+  WaitConditionWaiter(const WaitConditionWaiter&) = delete;
+  WaitConditionWaiter& operator=(const WaitConditionWaiter&) = delete;
+
+  // Block current thread until notified or deadline expired, for threads
+  // without event dispatcher. Flag is checked under mutex held by notify(), so
+  // no notification is lost.
+  static bool block(const WaitCondition& condition,
+                    const QDeadlineTimer& deadline) {
+    WaitCondition::Private* d = condition.d.data();
+    QMutexLocker locker(&d->mutex);
+    while (!condition.isNotified() && !deadline.hasExpired()) {
+      d->sleepers.wait(&d->mutex, deadline);
+    }
+    return condition.isNotified();
+  }
+
+ private:
+  WaitCondition::Private* d;
+  QAbstractEventDispatcher* dispatcher;
+};
+
+// Sleep in event dispatcher until condition notified or deadline expired.
+static bool WaitConditionUntil(const WaitCondition& condition,
+                               QDeadlineTimer deadline,
+                               QEventLoop::ProcessEventsFlags flags) {
+  if (condition.isNotified()) return true;
+  WaitScope scope("WaitCondition");
+  if (!HasEventDispatcher()) {
+    return WaitConditionWaiter::block(condition, deadline);
+  }
+
+  WaitConditionWaiter waiter(condition, CurrentDispatcher());
+  ProcessEventsUntil(deadline, flags,
+                     [&condition] { return condition.isNotified(); });
+  return condition.isNotified();
+}
+
+void Wait(const WaitCondition& condition,
+          QEventLoop::ProcessEventsFlags flags) {
+  WaitConditionUntil(condition, QDeadlineTimer(QDeadlineTimer::Forever),
+                     flags);
+}
+
+bool WaitFor(double timeout_milliseconds, QEventLoop::ProcessEventsFlags flags,
+             const WaitCondition& condition) {
+  return WaitConditionUntil(condition, DeadlineAfter(timeout_milliseconds),
+                            flags);
+}
+
+bool WaitUntil(const QDateTime& timeout_time,
+               QEventLoop::ProcessEventsFlags flags,
+               const WaitCondition& condition) {
+  return WaitFor(QDateTime::currentDateTime().msecsTo(timeout_time), flags,
+                 condition);
+}
+
+// Sleep in event dispatcher until condition notified(if given) or deadline
+// expired, woken up by timer wheel of current thread.
+static bool WaitWheelUntil(const QDeadlineTimer& deadline,
+                           QEventLoop::ProcessEventsFlags flags,
+                           const WaitCondition* condition) {
+  auto notified = [condition] { return condition && condition->isNotified(); };
+  if (notified()) return true;
+  WaitScope scope("WaitUntil");
+  if (!HasEventDispatcher()) {
+    if (condition) return WaitConditionWaiter::block(*condition, deadline);
+    SleepUntil(deadline);
+    return false;
+  }
+
+  QScopedPointer<WaitConditionWaiter> waiter;
+  if (condition) {
+    waiter.reset(new WaitConditionWaiter(*condition, CurrentDispatcher()));
+  }
+  QEventLoop loop;
+  bool expired = deadline.hasExpired();
+  TimerWheel::TimerId id = 0;
+  if (!expired && !deadline.isForever()) {
+    id = TimerWheel::instance()->schedule(deadline,
+                                          [&expired] { expired = true; });
+  }
+  while (!notified() && !expired) {
+    loop.processEvents(flags | QEventLoop::WaitForMoreEvents);
+  }
+  if (id != 0) TimerWheel::instance()->cancel(id);
+  return notified();
+}
+
+void WaitUntil(const QDeadlineTimer& deadline,
+               QEventLoop::ProcessEventsFlags flags) {
+  WaitWheelUntil(deadline, flags, nullptr);
+}
+
+bool WaitUntil(const QDeadlineTimer& deadline,
+               QEventLoop::ProcessEventsFlags flags,
+               const WaitCondition& condition) {
+  return WaitWheelUntil(deadline, flags, &condition);
+}
+/* ======================== WaitCondition ======================== */
+
+/* ======================== WaitGroup ======================== */
+struct WaitGroup::Private {
+  enum State { Pending, Completed, Abandoned };
+  enum Mode { Any, All };
+
+  QObject context;
+  QVector<State> states;
+  int first = -1;
+  int completed = 0;
+  int abandoned = 0;
+  Mode mode = Any;
+  QEventLoop* loop = nullptr;
+
+  bool isDone() const {
+    if (mode == Any) {
+      return (completed > 0) || (abandoned == states.size());
+    } else {
+      return (completed == states.size()) || (abandoned > 0);
+    }
+  }
+
+  void update() {
+    if (loop && isDone()) loop->quit();
+  }
+
+  void exec(Mode waitMode, double timeout_milliseconds,
+            QEventLoop::ProcessEventsFlags flags) {
+    mode = waitMode;
+    if (isDone()) return;
+    WaitScope scope("WaitGroup");
+
+    QEventLoop eventLoop;
+    QTimer timer;
+    if (timeout_milliseconds >= 0) {
+      timer.setSingleShot(true);
+      timer.setTimerType(Qt::PreciseTimer);
+      QObject::connect(&timer, &QTimer::timeout, &eventLoop,
+                       &QEventLoop::quit);
+      timer.start(qCeil(timeout_milliseconds));
+    }
+    loop = &eventLoop;
+    eventLoop.exec(flags);
+    loop = nullptr;
+  }
+};
+
+WaitGroup::WaitGroup() : d(new Private) {}
+
+WaitGroup::~WaitGroup() {}
+
+int WaitGroup::count() const { return d->states.size(); }
+
+bool WaitGroup::isCompleted(int index) const {
+  return d->states.value(index, Private::Pending) == Private::Completed;
+}
+
+int WaitGroup::waitAny(double timeout_milliseconds,
+                       QEventLoop::ProcessEventsFlags flags) {
+  d->exec(Private::Any, timeout_milliseconds, flags);
+  return d->first;
+}
+
+bool WaitGroup::waitAll(double timeout_milliseconds,
+                        QEventLoop::ProcessEventsFlags flags) {
+  d->exec(Private::All, timeout_milliseconds, flags);
+  return d->completed == d->states.size();
+}
+
+QObject* WaitGroup::context() const { return &d->context; }
+
+int WaitGroup::addItem() {
+  d->states << Private::Pending;
+  return d->states.size() - 1;
+}
+
+void WaitGroup::complete(int index) {
+  if (d->states[index] != Private::Pending) return;
+  d->states[index] = Private::Completed;
+  ++d->completed;
+  if (d->first < 0) d->first = index;
+  d->update();
+}
+
+void WaitGroup::abandon(int index) {
+  if (d->states[index] != Private::Pending) return;
+  d->states[index] = Private::Abandoned;
+  ++d->abandoned;
+  d->update();
+}
+/* ======================== WaitGroup ======================== */
 }  // namespace KtUtils
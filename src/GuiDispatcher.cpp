@@ -0,0 +1,172 @@
+#include <KtUtils/GuiDispatcher>
+#include <atomic>
+
+namespace KtUtils {
+static const QEvent::Type kDrainEvent =
+    QEvent::Type(QEvent::registerEventType());
+
+struct GuiDispatcher::Private {
+  struct Node {
+    std::atomic<Node*> next{nullptr};
+    bool keyed = false;
+    quint64 key = 0;
+    std::function<void(void)> fn;
+  };
+
+  // Vyukov's intrusive MPSC queue: producers exchange head, the consumer
+  // walks from tail. stub keeps the queue never empty.
+  std::atomic<Node*> head;
+  Node* tail;
+  Node stub;
+
+  std::atomic<bool> scheduled{false};  // A drain event is posted.
+  std::atomic<std::size_t> pending{0};  // Nodes pushed and not drained.
+  int frameInterval = 0;
+  QElapsedTimer lastDrain;
+  QTimer* frameTimer = nullptr;  // Child of dispatcher, moves with it.
+
+  Private() : head(&stub), tail(&stub) {}
+
+  ~Private() {
+    while (Node* node = pop()) {
+      delete node;
+    }
+  }
+
+  void push(Node* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* prev = head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  // Producers, returns true if a drain event should be posted.
+  bool enqueue(Node* node) {
+    push(node);
+    pending.fetch_add(1, std::memory_order_release);
+    // Only the first post of a batch posts an event.
+    return !scheduled.exchange(true, std::memory_order_acq_rel);
+  }
+
+  // Consumer only, nullptr if empty or a producer is in the middle of push.
+  Node* pop() {
+    Node* first = tail;
+    Node* next = first->next.load(std::memory_order_acquire);
+    if (first == &stub) {
+      if (!next) return nullptr;
+      tail = next;
+      first = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+      tail = next;
+      return first;
+    }
+    if (first != head.load(std::memory_order_acquire)) return nullptr;
+    push(&stub);
+    next = first->next.load(std::memory_order_acquire);
+    if (next) {
+      tail = next;
+      return first;
+    }
+    return nullptr;
+  }
+};
+
+GuiDispatcher::GuiDispatcher(QObject* parent)
+    : QObject(parent), d(new Private) {
+  d->lastDrain.start();
+  d->frameTimer = new QTimer(this);
+  d->frameTimer->setSingleShot(true);
+  d->frameTimer->setTimerType(Qt::PreciseTimer);
+  connect(d->frameTimer, &QTimer::timeout, this, [this] {
+    QCoreApplication::postEvent(this, new QEvent(kDrainEvent));
+  });
+}
+
+GuiDispatcher::~GuiDispatcher() {}
+
+GuiDispatcher* GuiDispatcher::instance() {
+  static GuiDispatcher* dispatcher = [] {
+    QCoreApplication* app = QCoreApplication::instance();
+    auto ret = new GuiDispatcher;
+    if (Q_UNLIKELY(!app)) {
+      qWarning() << "GuiDispatcher::instance: QCoreApplication is not created";
+      return ret;
+    }
+    ret->moveToThread(app->thread());
+    ret->setParent(app);
+    return ret;
+  }();
+  return dispatcher;
+}
+
+void GuiDispatcher::post(std::function<void(void)> fn) {
+  auto node = new Private::Node;
+  node->fn = std::move(fn);
+  if (d->enqueue(node)) {
+    QCoreApplication::postEvent(this, new QEvent(kDrainEvent));
+  }
+}
+
+void GuiDispatcher::post(quint64 key, std::function<void(void)> fn) {
+  auto node = new Private::Node;
+  node->keyed = true;
+  node->key = key;
+  node->fn = std::move(fn);
+  if (d->enqueue(node)) {
+    QCoreApplication::postEvent(this, new QEvent(kDrainEvent));
+  }
+}
+
+int GuiDispatcher::frameInterval() const { return d->frameInterval; }
+
+void GuiDispatcher::setFrameInterval(int interval_milliseconds) {
+  d->frameInterval = qMax(interval_milliseconds, 0);
+}
+
+bool GuiDispatcher::event(QEvent* event) {
+  if (event->type() != kDrainEvent) return QObject::event(event);
+
+  // Wait for next frame, posts in between join this batch.
+  const qint64 remaining = d->frameInterval - d->lastDrain.elapsed();
+  if (remaining > 0) {
+    if (!d->frameTimer->isActive()) d->frameTimer->start(int(remaining));
+    return true;
+  }
+  d->lastDrain.restart();
+
+  // Clear flag before draining, later posts schedule next batch. Exchange
+  // acquires the counts of posts which found the flag set.
+  d->scheduled.exchange(false, std::memory_order_acq_rel);
+  // Drain only nodes posted before this event, busy producers can't keep
+  // the batch growing.
+  const std::size_t count = d->pending.load(std::memory_order_acquire);
+  std::vector<Private::Node*> batch;
+  batch.reserve(count);
+  while (batch.size() < count) {
+    Private::Node* node = d->pop();
+    if (!node) break;
+    batch.push_back(node);
+  }
+  d->pending.fetch_sub(batch.size(), std::memory_order_relaxed);
+  // An earlier producer is in the middle of push, continue in a fresh event.
+  if ((batch.size() < count) &&
+      !d->scheduled.exchange(true, std::memory_order_acq_rel)) {
+    QCoreApplication::postEvent(this, new QEvent(kDrainEvent));
+  }
+
+  // Latest position of each key.
+  QHash<quint64, std::size_t> latest;
+  for (std::size_t i = 0; i < batch.size(); ++i) {
+    if (batch[i]->keyed) latest[batch[i]->key] = i;
+  }
+  for (std::size_t i = 0; i < batch.size(); ++i) {
+    Private::Node* node = batch[i];
+    if (!node->keyed || (latest.value(node->key) == i)) {
+      if (node->fn) node->fn();
+    }
+    delete node;
+  }
+  return true;
+}
+}  // namespace KtUtils
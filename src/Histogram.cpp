@@ -0,0 +1,146 @@
+#include <KtUtils/Histogram>
+
+namespace KtUtils {
+static constexpr int kSubBucketBits = 4;
+static_assert((1 << kSubBucketBits) == Histogram::kSubBucketCount,
+              "Sub-bucket count must match its bits");
+
+Histogram::Histogram() { reset(); }
+
+Histogram::Histogram(const Histogram& other) {
+  reset();
+  merge(other);
+}
+
+Histogram& Histogram::operator=(const Histogram& other) {
+  if (this != &other) {
+    reset();
+    merge(other);
+  }
+  return *this;
+}
+
+void Histogram::record(qint64 value) {
+  value = qMax<qint64>(value, 0);
+  buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  total.fetch_add(1, std::memory_order_relaxed);
+  sum.fetch_add(value, std::memory_order_relaxed);
+
+  qint64 current = minimum.load(std::memory_order_relaxed);
+  while ((value < current) &&
+         !minimum.compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+  current = maximum.load(std::memory_order_relaxed);
+  while ((value > current) &&
+         !maximum.compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+void Histogram::merge(const Histogram& other) {
+  for (int i = 0; i < kBucketCount; ++i) {
+    buckets[i].fetch_add(other.buckets[i].load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+  }
+  total.fetch_add(other.total.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+  sum.fetch_add(other.sum.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+
+  const qint64 otherMin = other.minimum.load(std::memory_order_relaxed);
+  qint64 current = minimum.load(std::memory_order_relaxed);
+  while ((otherMin < current) &&
+         !minimum.compare_exchange_weak(current, otherMin,
+                                        std::memory_order_relaxed)) {
+  }
+  const qint64 otherMax = other.maximum.load(std::memory_order_relaxed);
+  current = maximum.load(std::memory_order_relaxed);
+  while ((otherMax > current) &&
+         !maximum.compare_exchange_weak(current, otherMax,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+void Histogram::reset() {
+  for (auto& bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  total.store(0, std::memory_order_relaxed);
+  sum.store(0, std::memory_order_relaxed);
+  minimum.store(std::numeric_limits<qint64>::max(), std::memory_order_relaxed);
+  maximum.store(0, std::memory_order_relaxed);
+}
+
+quint64 Histogram::count() const {
+  return total.load(std::memory_order_relaxed);
+}
+
+qint64 Histogram::min() const {
+  return (count() > 0) ? minimum.load(std::memory_order_relaxed) : 0;
+}
+
+qint64 Histogram::max() const {
+  return maximum.load(std::memory_order_relaxed);
+}
+
+double Histogram::mean() const {
+  const quint64 n = count();
+  return (n > 0) ? (double(sum.load(std::memory_order_relaxed)) / n) : 0.0;
+}
+
+qint64 Histogram::percentile(double percentile) const {
+  const quint64 n = count();
+  if (n == 0) return 0;
+
+  const quint64 rank = qMax<quint64>(
+      1, quint64(qBound(0.0, percentile, 100.0) / 100.0 * n + 0.5));
+  quint64 accumulated = 0;
+  for (int i = 0; i < kBucketCount; ++i) {
+    accumulated += buckets[i].load(std::memory_order_relaxed);
+    if (accumulated >= rank) {
+      return qMin(qMax(bucketLowerBound(i), min()), max());
+    }
+  }
+  return max();
+}
+
+QJsonObject Histogram::toJson() const {
+  QJsonArray array;
+  for (int i = 0; i < kBucketCount; ++i) {
+    const quint64 n = buckets[i].load(std::memory_order_relaxed);
+    if (n > 0) {
+      array << QJsonArray{double(bucketLowerBound(i)), double(n)};
+    }
+  }
+  return QJsonObject{
+      {QStringLiteral("count"), double(count())},
+      {QStringLiteral("min"), double(min())},
+      {QStringLiteral("max"), double(max())},
+      {QStringLiteral("mean"), mean()},
+      {QStringLiteral("p50"), double(percentile(50))},
+      {QStringLiteral("p90"), double(percentile(90))},
+      {QStringLiteral("p99"), double(percentile(99))},
+      {QStringLiteral("p999"), double(percentile(99.9))},
+      {QStringLiteral("buckets"), array},
+  };
+}
+
+int Histogram::bucketIndex(qint64 value) {
+  if (value < kSubBucketCount) return int(qMax<qint64>(value, 0));
+
+  // Position of highest bit, value is in [2^exponent, 2^(exponent + 1)).
+  const int exponent = 63 - int(qCountLeadingZeroBits(quint64(value)));
+  const int sub = int((value >> (exponent - kSubBucketBits)) &
+                      (kSubBucketCount - 1));
+  return (exponent - kSubBucketBits + 1) * kSubBucketCount + sub;
+}
+
+qint64 Histogram::bucketLowerBound(int index) {
+  if (index < kSubBucketCount) return index;
+
+  const int exponent = index / kSubBucketCount + kSubBucketBits - 1;
+  const int sub = index % kSubBucketCount;
+  return qint64(kSubBucketCount + sub) << (exponent - kSubBucketBits);
+}
+}  // namespace KtUtils
@@ -1,4 +1,6 @@
-﻿#include <KtUtils/IconHelper>
+﻿#include "IconHelper_p.hpp"
+#include <KtUtils/IconHelper>
+#include <KtUtils/Trace>
 
 void InitializeResources() {
 #ifndef KTUTILS_SHARED_LIBRARY
@@ -11,6 +13,50 @@ void InitializeResources() {
 }
 
 namespace KtUtils {
+Histogram& ParseTimeHistogram() {
+  static Histogram histogram;
+  return histogram;
+}
+
+Histogram& RasterizeTimeHistogram() {
+  static Histogram histogram;
+  return histogram;
+}
+
+static QMutex& CacheRegistryMutex() {
+  static QMutex mutex;
+  return mutex;
+}
+
+static QVector<IconCacheBase*>& CacheRegistry() {
+  static QVector<IconCacheBase*> registry;
+  return registry;
+}
+
+std::atomic<qint64> IconCacheBase::limit{0};
+
+IconCacheBase::IconCacheBase(const char* cacheName)
+    : name(cacheName), hits(0), misses(0), evictions(0) {
+  QMutexLocker locker(&CacheRegistryMutex());
+  CacheRegistry() << this;
+}
+
+IconCacheBase::~IconCacheBase() {
+  QMutexLocker locker(&CacheRegistryMutex());
+  CacheRegistry().removeAll(this);
+}
+
+QVector<IconCacheBase*> IconCacheBase::caches() {
+  QMutexLocker locker(&CacheRegistryMutex());
+  return CacheRegistry();
+}
+
+void IconCacheBase::resetStatistics() {
+  hits.store(0, std::memory_order_relaxed);
+  misses.store(0, std::memory_order_relaxed);
+  evictions.store(0, std::memory_order_relaxed);
+}
+
 //  Add path/fill attribute to svg
 void SetColor(QXmlStreamReader& reader, QXmlStreamWriter& writer,
               const QString& value) {
@@ -77,7 +123,10 @@ void SetColor(QXmlStreamReader& reader, QXmlStreamWriter& writer,
 
 QSharedPointer<QSvgRenderer> GetRenderer(IconHelper::Icon iconType,
                                          QColor color) {
+  KTUTILS_TRACE_SCOPE("IconHelper::GetRenderer");
   InitializeResources();
+  QElapsedTimer timer;
+  timer.start();
 
   static QMetaObject mo = IconHelper::staticMetaObject;
   static QMetaEnum me = mo.enumerator(0);
@@ -96,10 +145,15 @@ QSharedPointer<QSvgRenderer> GetRenderer(IconHelper::Icon iconType,
 
   SetColor(reader, writer, color.name(QColor::HexRgb));
 
-  return QSharedPointer<QSvgRenderer>::create(xml.toUtf8());
+  auto renderer = QSharedPointer<QSvgRenderer>::create(xml.toUtf8());
+  ParseTimeHistogram().record(timer.nsecsElapsed());
+  return renderer;
 }
 
 QPixmap RenderPixmap(QSharedPointer<QSvgRenderer> renderer, int size) {
+  KTUTILS_TRACE_SCOPE("IconHelper::RenderPixmap");
+  QElapsedTimer timer;
+  timer.start();
   QPixmap pixmap = QPixmap(size, size);
   pixmap.fill(Qt::transparent);
 
@@ -113,33 +167,24 @@ QPixmap RenderPixmap(QSharedPointer<QSvgRenderer> renderer, int size) {
   renderer->render(&painter, rect);
   painter.end();
 
+  RasterizeTimeHistogram().record(timer.nsecsElapsed());
   return pixmap;
 }
 
 QPixmap IconHelper::pixmap(Icon iconType, int size, const QColor& color,
                            bool cached) {
-  static QMutex mutex;
   using Key = std::tuple<Icon, int, QColor, bool>;
-  static std::vector<std::pair<Key, QPixmap>> cache;
-  if (cached) {
-    QMutexLocker locker(&mutex);
-    auto it = std::find_if(cache.begin(), cache.end(),
-                           [&](const std::pair<Key, QPixmap>& p) {
-                             return std::get<0>(p.first) == iconType &&
-                                    std::get<1>(p.first) == size &&
-                                    std::get<2>(p.first) == color &&
-                                    std::get<3>(p.first) == cached;
-                           });
-    if (it != cache.end()) {
-      return it->second;
-    }
+  static IconCache<Key, QPixmap> cache("pixmap");
+  const Key key{iconType, size, color, cached};
+  QPixmap pixmap;
+  if (cached && cache.find(key, &pixmap)) {
+    return pixmap;
   }
 
   QSharedPointer<QSvgRenderer> renderer = GetRenderer(iconType, color);
-  QPixmap pixmap = RenderPixmap(renderer, size);
+  pixmap = RenderPixmap(renderer, size);
   if (cached) {
-    QMutexLocker locker(&mutex);
-    cache.emplace_back(Key{iconType, size, color, cached}, pixmap);
+    cache.insert(key, pixmap);
   }
   return pixmap;
 }
@@ -148,19 +193,13 @@ QIcon IconHelper::icon(Icon iconType, const QColor& color, bool cached) {
   static const QVector<int> sizes = {16, 24, 32,  36,  48,  64,
                                      72, 96, 128, 144, 192, 256};
 
-  static QMutex mutex;
   using Key = std::tuple<Icon, QColor, bool>;
-  static std::vector<std::pair<Key, QIcon>> cache;
+  static IconCache<Key, QIcon> cache("icon");
+  const Key key{iconType, color, cached};
   if (cached) {
-    QMutexLocker locker(&mutex);
-    auto it = std::find_if(cache.begin(), cache.end(),
-                           [&](const std::pair<Key, QIcon>& p) {
-                             return std::get<0>(p.first) == iconType &&
-                                    std::get<1>(p.first) == color &&
-                                    std::get<2>(p.first) == cached;
-                           });
-    if (it != cache.end()) {
-      return it->second;
+    QIcon icon;
+    if (cache.find(key, &icon)) {
+      return icon;
     }
   }
 
@@ -181,12 +220,101 @@ QIcon IconHelper::icon(Icon iconType, const QColor& color, bool cached) {
     icon.addPixmap(px, QIcon::Disabled, QIcon::Off);
   }
   if (cached) {
-    QMutexLocker locker(&mutex);
-    cache.emplace_back(Key{iconType, color, cached}, icon);
+    cache.insert(key, icon);
   }
   return icon;
 }
 
+// Rect of overlay with given size, placed at the corner of base icon.
+QRect OverlayRect(int size, const QSize& overlaySize, Qt::Corner corner) {
+  QRect rect(QPoint(0, 0), overlaySize);
+  switch (corner) {
+    case Qt::TopLeftCorner:
+      break;
+
+    case Qt::TopRightCorner:
+      rect.moveTopRight(QPoint(size - 1, 0));
+      break;
+
+    case Qt::BottomLeftCorner:
+      rect.moveBottomLeft(QPoint(0, size - 1));
+      break;
+
+    case Qt::BottomRightCorner:
+      rect.moveBottomRight(QPoint(size - 1, size - 1));
+      break;
+  }
+  return rect;
+}
+
+QPixmap IconHelper::composite(Icon iconType, Icon overlayType, int size,
+                              const QColor& color, const QColor& overlayColor,
+                              Qt::Corner corner, bool cached) {
+  using Key = std::tuple<Icon, Icon, int, QColor, QColor, Qt::Corner, bool>;
+  static IconCache<Key, QPixmap> cache("composite");
+  const Key key{iconType, overlayType, size, color, overlayColor, corner,
+                cached};
+  QPixmap pixmap;
+  if (cached && cache.find(key, &pixmap)) {
+    return pixmap;
+  }
+
+  const int overlaySize = qMax(1, size / 2);
+  pixmap = IconHelper::pixmap(iconType, size, color, cached);
+  QPainter painter;
+  painter.begin(&pixmap);
+  painter.drawPixmap(
+      OverlayRect(size, QSize(overlaySize, overlaySize), corner),
+      IconHelper::pixmap(overlayType, overlaySize, overlayColor, cached));
+  painter.end();
+  if (cached) {
+    cache.insert(key, pixmap);
+  }
+  return pixmap;
+}
+
+QPixmap IconHelper::composite(Icon iconType, const QString& text, int size,
+                              const QColor& color, const QColor& textColor,
+                              const QColor& badgeColor, Qt::Corner corner,
+                              bool cached) {
+  using Key =
+      std::tuple<Icon, QString, int, QColor, QColor, QColor, Qt::Corner, bool>;
+  static IconCache<Key, QPixmap> cache("badge");
+  const Key key{iconType,   text,   size,  color, textColor,
+                badgeColor, corner, cached};
+  QPixmap pixmap;
+  if (cached && cache.find(key, &pixmap)) {
+    return pixmap;
+  }
+
+  pixmap = IconHelper::pixmap(iconType, size, color, cached);
+
+  const int badgeHeight = qMax(1, size / 2);
+  QFont font;
+  font.setPixelSize(qMax(1, badgeHeight * 3 / 4));
+  font.setBold(true);
+  const int textWidth = QFontMetrics(font).horizontalAdvance(text);
+  const int badgeWidth = qMin(size, qMax(badgeHeight, textWidth + 4));
+  const QRect rect =
+      OverlayRect(size, QSize(badgeWidth, badgeHeight), corner);
+
+  QPainter painter;
+  painter.begin(&pixmap);
+  painter.setRenderHint(QPainter::Antialiasing);
+  painter.setRenderHint(QPainter::TextAntialiasing);
+  painter.setPen(Qt::NoPen);
+  painter.setBrush(badgeColor);
+  painter.drawRoundedRect(rect, badgeHeight / 2.0, badgeHeight / 2.0);
+  painter.setPen(textColor);
+  painter.setFont(font);
+  painter.drawText(rect, Qt::AlignCenter, text);
+  painter.end();
+  if (cached) {
+    cache.insert(key, pixmap);
+  }
+  return pixmap;
+}
+
 QFont IconHelper::font(Font fontType) {
   InitializeResources();
 
@@ -205,30 +333,21 @@ QFont IconHelper::font(Font fontType) {
 QPixmap IconHelper::pixmap(Font fontType, QChar ch, int size,
                            const QColor& color, QFont::Weight weight,
                            bool cached) {
-  static QMutex mutex;
   using Key = std::tuple<Font, QChar, int, QColor, QFont::Weight, bool>;
-  static std::vector<std::pair<Key, QPixmap>> cache;
-
-  if (cached) {
-    QMutexLocker locker(&mutex);
-    auto it = std::find_if(
-        cache.begin(), cache.end(), [&](const std::pair<Key, QPixmap>& p) {
-          return std::get<0>(p.first) == fontType &&
-                 std::get<1>(p.first) == ch && std::get<2>(p.first) == size &&
-                 std::get<3>(p.first) == color &&
-                 std::get<4>(p.first) == weight &&
-                 std::get<5>(p.first) == cached;
-        });
-    if (it != cache.end()) {
-      return it->second;
-    }
+  static IconCache<Key, QPixmap> cache("fontPixmap");
+  const Key key{fontType, ch, size, color, weight, cached};
+  QPixmap pixmap;
+  if (cached && cache.find(key, &pixmap)) {
+    return pixmap;
   }
 
+  QElapsedTimer timer;
+  timer.start();
   QFont font = IconHelper::font(fontType);
   font.setPixelSize(size);
   font.setWeight(weight);
 
-  QPixmap pixmap(size, size);
+  pixmap = QPixmap(size, size);
   pixmap.fill(Qt::transparent);
   QPainter painter;
   painter.begin(&pixmap);
@@ -236,9 +355,9 @@ QPixmap IconHelper::pixmap(Font fontType, QChar ch, int size,
   painter.setFont(font);
   painter.drawText(QRect(0, 0, size, size), Qt::AlignCenter, QString(ch));
   painter.end();
+  RasterizeTimeHistogram().record(timer.nsecsElapsed());
   if (cached) {
-    QMutexLocker locker(&mutex);
-    cache.emplace_back(Key{fontType, ch, size, color, weight, cached}, pixmap);
+    cache.insert(key, pixmap);
   }
   return pixmap;
 }
@@ -248,21 +367,13 @@ QIcon IconHelper::icon(Font fontType, QChar ch, const QColor& color,
   static const QVector<int> sizes = {16, 24, 32,  36,  48,  64,
                                      72, 96, 128, 144, 192, 256};
 
-  static QMutex mutex;
   using Key = std::tuple<Font, QChar, QColor, QFont::Weight, bool>;
-  static std::vector<std::pair<Key, QIcon>> cache;
-
+  static IconCache<Key, QIcon> cache("fontIcon");
+  const Key key{fontType, ch, color, weight, cached};
   if (cached) {
-    QMutexLocker locker(&mutex);
-    auto it = std::find_if(
-        cache.begin(), cache.end(), [&](const std::pair<Key, QIcon>& p) {
-          return std::get<0>(p.first) == fontType &&
-                 std::get<1>(p.first) == ch && std::get<2>(p.first) == color &&
-                 std::get<3>(p.first) == weight &&
-                 std::get<4>(p.first) == cached;
-        });
-    if (it != cache.end()) {
-      return it->second;
+    QIcon icon;
+    if (cache.find(key, &icon)) {
+      return icon;
     }
   }
 
@@ -281,9 +392,284 @@ QIcon IconHelper::icon(Font fontType, QChar ch, const QColor& color,
     icon.addPixmap(px, QIcon::Disabled, QIcon::Off);
   }
   if (cached) {
-    QMutexLocker locker(&mutex);
-    cache.emplace_back(Key{fontType, ch, color, weight, cached}, icon);
+    cache.insert(key, icon);
   }
   return icon;
 }
+
+/* ======================== Animation ======================== */
+// Interval of the shared animation clock, shorter than every frame duration.
+static constexpr int kAnimationInterval = 40;
+
+struct AnimationSpec {
+  int frameCount;
+  int period;  // Milliseconds for one round.
+};
+
+AnimationSpec GetAnimationSpec(IconHelper::Animation animation) {
+  switch (animation) {
+    case IconHelper::Pulse:
+      return {8, 1000};
+
+    case IconHelper::Spin:
+    default:
+      return {24, 2000};
+  }
+}
+
+// Frame index of given animation at current time, all animations share the
+// same start time so they are in step.
+int CurrentFrame(IconHelper::Animation animation) {
+  static const QElapsedTimer kClock = [] {
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+  }();
+  const AnimationSpec spec = GetAnimationSpec(animation);
+  return int((kClock.elapsed() % spec.period) * spec.frameCount / spec.period);
+}
+
+struct AnimationFrames {
+  QPixmap strip;
+  QVector<QPixmap> frames;
+};
+
+// Frames are copied from the strip, so they take the same memory.
+qint64 CostOf(const AnimationFrames& frames) {
+  return CostOf(frames.strip) * 2;
+}
+
+AnimationFrames GetAnimationFrames(IconHelper::Icon iconType, int size,
+                                   const QColor& color,
+                                   IconHelper::Animation animation) {
+  using Key = std::tuple<IconHelper::Icon, int, QColor, IconHelper::Animation>;
+  static IconCache<Key, AnimationFrames> cache("animation");
+  const Key key{iconType, size, color, animation};
+  AnimationFrames ret;
+  if (cache.find(key, &ret)) {
+    return ret;
+  }
+
+  const int count = GetAnimationSpec(animation).frameCount;
+  QSharedPointer<QSvgRenderer> renderer = GetRenderer(iconType, color);
+  QElapsedTimer timer;
+  timer.start();
+  QSizeF svgSize =
+      renderer->defaultSize().scaled(size, size, Qt::KeepAspectRatio);
+  QRectF rect(QPointF(-svgSize.width() / 2.0, -svgSize.height() / 2.0),
+              svgSize);
+
+  ret.strip = QPixmap(size * count, size);
+  ret.strip.fill(Qt::transparent);
+  QPainter painter;
+  painter.begin(&ret.strip);
+  painter.setRenderHint(QPainter::Antialiasing);
+  for (int i = 0; i < count; ++i) {
+    painter.save();
+    painter.setClipRect(i * size, 0, size, size);
+    painter.translate(i * size + size / 2.0, size / 2.0);
+    painter.rotate(360.0 * i / count);
+    renderer->render(&painter, rect);
+    painter.restore();
+  }
+  painter.end();
+
+  ret.frames.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    ret.frames << ret.strip.copy(i * size, 0, size, size);
+  }
+  RasterizeTimeHistogram().record(timer.nsecsElapsed());
+  cache.insert(key, ret);
+  return ret;
+}
+
+// Single timer to advance all animated widgets, only visible widgets are
+// updated, and only when their frame changes.
+class AnimationClock : public QObject {
+ public:
+  static AnimationClock* instance() {
+    static QPointer<AnimationClock> clock;
+    if (!clock) {
+      clock = new AnimationClock(QCoreApplication::instance());
+    }
+    return clock;
+  }
+
+  void add(QWidget* widget, IconHelper::Animation animation,
+           std::function<void(int)> apply) {
+    remove(widget);
+    Target& target = targets[widget];
+    target.animation = animation;
+    target.apply = std::move(apply);
+    target.connection = connect(widget, &QObject::destroyed, this,
+                                [this, widget] { targets.remove(widget); });
+    if (!timer->isActive()) {
+      timer->start();
+    }
+  }
+
+  void remove(QWidget* widget) {
+    auto it = targets.find(widget);
+    if (it != targets.end()) {
+      disconnect(it->connection);
+      targets.erase(it);
+    }
+  }
+
+ private:
+  explicit AnimationClock(QObject* parent)
+      : QObject(parent), timer(new QTimer(this)) {
+    // Named to be found in tests, as a child of the application.
+    setObjectName(QStringLiteral("KtUtils::AnimationClock"));
+    timer->setInterval(kAnimationInterval);
+    connect(timer, &QTimer::timeout, this, &AnimationClock::tick);
+  }
+
+  void tick() {
+    QVector<QWidget*> changed;
+    for (auto it = targets.begin(); it != targets.end(); ++it) {
+      QWidget* widget = it.key();
+      if (!widget->isVisible() || widget->visibleRegion().isEmpty()) continue;
+      const int frame = CurrentFrame(it->animation);
+      if (frame == it->frame) continue;
+      it->frame = frame;
+      changed << widget;
+    }
+
+    // Apply after iteration, targets may be changed by callbacks.
+    for (QWidget* widget : changed) {
+      auto it = targets.find(widget);
+      if (it != targets.end()) {
+        it->apply(it->frame);
+      }
+    }
+
+    if (targets.isEmpty()) {
+      timer->stop();
+    }
+  }
+
+  struct Target {
+    IconHelper::Animation animation = IconHelper::Spin;
+    int frame = -1;
+    std::function<void(int)> apply;
+    QMetaObject::Connection connection;
+  };
+  QHash<QWidget*, Target> targets;
+  QTimer* timer;
+};
+
+int IconHelper::animationFrameCount(Animation animation) {
+  return GetAnimationSpec(animation).frameCount;
+}
+
+QPixmap IconHelper::animationStrip(Icon iconType, int size,
+                                   const QColor& color, Animation animation) {
+  return GetAnimationFrames(iconType, size, color, animation).strip;
+}
+
+QPixmap IconHelper::animationFrame(Icon iconType, int size,
+                                   const QColor& color, Animation animation) {
+  return GetAnimationFrames(iconType, size, color, animation)
+      .frames.at(CurrentFrame(animation));
+}
+
+void IconHelper::SetAnimatedIcon(QWidget* widget, Icon iconType, int size,
+                                 const QColor& color, Animation animation) {
+  if (Q_UNLIKELY(!widget)) {
+    qWarning() << "IconHelper::SetAnimatedIcon: widget is nullptr";
+    return;
+  }
+
+  const QVector<QPixmap> frames =
+      GetAnimationFrames(iconType, size, color, animation).frames;
+  widget->setProperty("icon", QIcon(frames.at(CurrentFrame(animation))));
+  AnimationClock::instance()->add(widget, animation, [widget, frames](int i) {
+    widget->setProperty("icon", QIcon(frames.at(i)));
+  });
+}
+
+void IconHelper::StartAnimation(QWidget* widget, Animation animation) {
+  if (Q_UNLIKELY(!widget)) {
+    qWarning() << "IconHelper::StartAnimation: widget is nullptr";
+    return;
+  }
+
+  AnimationClock::instance()->add(widget, animation,
+                                  [widget](int) { widget->update(); });
+}
+
+void IconHelper::StopAnimation(QWidget* widget) {
+  AnimationClock::instance()->remove(widget);
+}
+/* ======================== Animation ======================== */
+
+/* ======================== Statistics ======================== */
+QJsonObject IconHelper::Statistics::toJson() const {
+  QJsonArray cacheArray;
+  for (const CacheStatistics& cache : caches) {
+    cacheArray << QJsonObject{
+        {QStringLiteral("name"), cache.name},
+        {QStringLiteral("hits"), double(cache.hits)},
+        {QStringLiteral("misses"), double(cache.misses)},
+        {QStringLiteral("evictions"), double(cache.evictions)},
+        {QStringLiteral("bytes"), double(cache.bytes)},
+        {QStringLiteral("entries"), cache.entries},
+    };
+  }
+
+  QJsonArray keyArray;
+  for (const auto& key : topKeys) {
+    keyArray << QJsonObject{{QStringLiteral("key"), key.first},
+                            {QStringLiteral("requests"), double(key.second)}};
+  }
+
+  return QJsonObject{
+      {QStringLiteral("caches"), cacheArray},
+      {QStringLiteral("parseTime"), parseTime.toJson()},
+      {QStringLiteral("rasterizeTime"), rasterizeTime.toJson()},
+      {QStringLiteral("topKeys"), keyArray},
+  };
+}
+
+IconHelper::Statistics IconHelper::statistics(int topCount) {
+  Statistics ret;
+  const QVector<IconCacheBase*> caches = IconCacheBase::caches();
+  for (IconCacheBase* cache : caches) {
+    ret.caches << cache->statistics();
+    cache->topKeys(topCount, &ret.topKeys);
+  }
+  std::sort(ret.topKeys.begin(), ret.topKeys.end(),
+            [](const QPair<QString, quint64>& lhs,
+               const QPair<QString, quint64>& rhs) {
+              return lhs.second > rhs.second;
+            });
+  if (ret.topKeys.size() > topCount) {
+    ret.topKeys.resize(qMax(topCount, 0));
+  }
+  ret.parseTime = ParseTimeHistogram();
+  ret.rasterizeTime = RasterizeTimeHistogram();
+  return ret;
+}
+
+void IconHelper::resetStatistics() {
+  for (IconCacheBase* cache : IconCacheBase::caches()) {
+    cache->resetStatistics();
+  }
+  ParseTimeHistogram().reset();
+  RasterizeTimeHistogram().reset();
+}
+
+void IconHelper::setCacheLimit(qint64 bytes) {
+  IconCacheBase::limit.store(qMax<qint64>(bytes, 0));
+}
+
+qint64 IconHelper::cacheLimit() { return IconCacheBase::limit.load(); }
+
+void IconHelper::clearCache() {
+  for (IconCacheBase* cache : IconCacheBase::caches()) {
+    cache->clear();
+  }
+}
+/* ======================== Statistics ======================== */
 }  // namespace KtUtils
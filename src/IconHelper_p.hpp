@@ -0,0 +1,186 @@
+#pragma once
+#ifndef KTUTILS_ICONHELPER_P_HPP
+#define KTUTILS_ICONHELPER_P_HPP
+
+#include <KtUtils/IconHelper.hpp>
+
+namespace KtUtils {
+// Readable text for each part of cache keys.
+inline QString ToString(IconHelper::Icon iconType) {
+  return QString::fromLatin1(
+      QMetaEnum::fromType<IconHelper::Icon>().valueToKey(iconType));
+}
+inline QString ToString(int value) { return QString::number(value); }
+inline QString ToString(bool value) {
+  return value ? QStringLiteral("true") : QStringLiteral("false");
+}
+inline QString ToString(const QColor& color) {
+  return color.name(QColor::HexArgb);
+}
+inline QString ToString(QChar ch) {
+  return QStringLiteral("U+%1").arg(ch.unicode(), 4, 16, QChar('0'));
+}
+inline QString ToString(const QString& text) { return text; }
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value, QString>::type ToString(
+    T value) {
+  return QString::number(int(value));
+}
+
+template <typename Tuple, std::size_t... I>
+inline QString KeyToString(const Tuple& key, std::index_sequence<I...>) {
+  return QStringList{ToString(std::get<I>(key))...}.join(',');
+}
+template <typename... T>
+inline QString KeyToString(const std::tuple<T...>& key) {
+  return KeyToString(key, std::index_sequence_for<T...>{});
+}
+
+// Memory held by cached values.
+inline qint64 CostOf(const QPixmap& pixmap) {
+  return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+inline qint64 CostOf(const QIcon& icon) {
+  qint64 cost = 0;
+  for (QIcon::Mode mode : {QIcon::Normal, QIcon::Disabled}) {
+    for (const QSize& size : icon.availableSizes(mode)) {
+      cost += qint64(size.width()) * size.height() * 4;
+    }
+  }
+  return cost;
+}
+
+// Nanoseconds spent in svg parsing and rasterization.
+Histogram& ParseTimeHistogram();
+Histogram& RasterizeTimeHistogram();
+
+// Type erased base of caches, to collect statistics from all caches.
+// Exported for tests which instantiate IconCache directly.
+class KTUTILS_EXPORT IconCacheBase {
+ public:
+  explicit IconCacheBase(const char* cacheName);
+  virtual ~IconCacheBase();
+  IconCacheBase(const IconCacheBase&) = delete;
+  IconCacheBase& operator=(const IconCacheBase&) = delete;
+
+  // All alive caches.
+  static QVector<IconCacheBase*> caches();
+  // Global memory limit of each cache in bytes, 0 means unlimited.
+  static std::atomic<qint64> limit;
+
+  virtual IconHelper::CacheStatistics statistics() const = 0;
+  // Append most requested keys and their request count into `keys`.
+  virtual void topKeys(int count,
+                       QVector<QPair<QString, quint64>>* keys) const = 0;
+  virtual void clear() = 0;
+  void resetStatistics();
+
+ protected:
+  const char* name;
+  std::atomic<quint64> hits;
+  std::atomic<quint64> misses;
+  std::atomic<quint64> evictions;
+};
+
+// Thread safe cache for generated pixmaps and icons.
+template <typename Key, typename Value>
+class IconCache : public IconCacheBase {
+ public:
+  explicit IconCache(const char* cacheName) : IconCacheBase(cacheName) {}
+
+  // Copy cached value of given key into `value`, return false if not found.
+  bool find(const Key& key, Value* value) {
+    QMutexLocker locker(&mutex);
+    auto it = std::find_if(items.begin(), items.end(),
+                           [&key](const Item& item) { return item.key == key; });
+    if (it == items.end()) {
+      misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    ++it->requests;
+    *value = it->value;
+    return true;
+  }
+
+  void insert(const Key& key, const Value& value) {
+    QMutexLocker locker(&mutex);
+    // Threads missing the same key concurrently, first one is kept.
+    if (std::any_of(items.begin(), items.end(),
+                    [&key](const Item& item) { return item.key == key; })) {
+      return;
+    }
+    items.push_back(Item{key, value, 1, CostOf(value)});
+    bytes += items.back().bytes;
+
+    // Evict oldest items until memory limit satisfied, the new item is kept
+    // even if it alone exceeds the limit.
+    const qint64 maxBytes = limit.load(std::memory_order_relaxed);
+    if (maxBytes <= 0) return;
+    auto end = items.begin();
+    while ((bytes > maxBytes) && (end != (items.end() - 1))) {
+      bytes -= end->bytes;
+      ++end;
+    }
+    evictions.fetch_add(quint64(end - items.begin()),
+                        std::memory_order_relaxed);
+    items.erase(items.begin(), end);
+  }
+
+  IconHelper::CacheStatistics statistics() const override {
+    IconHelper::CacheStatistics ret;
+    ret.name = QString::fromLatin1(name);
+    ret.hits = hits.load(std::memory_order_relaxed);
+    ret.misses = misses.load(std::memory_order_relaxed);
+    ret.evictions = evictions.load(std::memory_order_relaxed);
+    QMutexLocker locker(&mutex);
+    ret.bytes = bytes;
+    ret.entries = int(items.size());
+    return ret;
+  }
+
+  void topKeys(int count,
+               QVector<QPair<QString, quint64>>* keys) const override {
+    std::vector<std::pair<quint64, Key>> top;
+    {
+      QMutexLocker locker(&mutex);
+      for (const Item& item : items) {
+        top.emplace_back(item.requests, item.key);
+      }
+    }
+    const auto middle = top.begin() + std::min<std::size_t>(count, top.size());
+    std::partial_sort(top.begin(), middle, top.end(),
+                      [](const std::pair<quint64, Key>& lhs,
+                         const std::pair<quint64, Key>& rhs) {
+                        return lhs.first > rhs.first;
+                      });
+    for (auto it = top.begin(); it != middle; ++it) {
+      keys->append(qMakePair(QStringLiteral("%1(%2)").arg(
+                                 QString::fromLatin1(name),
+                                 KeyToString(it->second)),
+                             it->first));
+    }
+  }
+
+  void clear() override {
+    QMutexLocker locker(&mutex);
+    evictions.fetch_add(items.size(), std::memory_order_relaxed);
+    items.clear();
+    bytes = 0;
+  }
+
+ private:
+  struct Item {
+    Key key;
+    Value value;
+    quint64 requests;
+    qint64 bytes;
+  };
+
+  mutable QMutex mutex;
+  std::vector<Item> items;
+  qint64 bytes = 0;
+};
+}  // namespace KtUtils
+
+#endif  // KTUTILS_ICONHELPER_P_HPP
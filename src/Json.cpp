@@ -1,15 +1,46 @@
 #include "KtUtils/Json.hpp"
+#include <KtUtils/Executor>
+#include <KtUtils/Trace>
 #include "Settings_p.hpp"
 
 namespace KtUtils {
 namespace Json {
+namespace {
+// Item of toStandardItem(), stores its text once as Qt::DisplayRole, which
+// QStandardItem shares with Qt::EditRole, and derives Qt::AccessibleTextRole
+// from it instead of storing another copy. Values keep their json type as
+// the type of the variant.
+class JsonItem : public QStandardItem {
+ public:
+  static constexpr int kType = QStandardItem::UserType + 1;
+
+  // Name at column 0, or value at column 1 if json is neither object nor
+  // array.
+  explicit JsonItem(const QVariant& text) {
+    QStandardItem::setData(text, Qt::DisplayRole);
+  }
+
+  QVariant data(int role = Qt::UserRole + 1) const override {
+    QVariant ret = QStandardItem::data(role);
+    if ((role == Qt::AccessibleTextRole) && !ret.isValid()) {
+      ret = QStandardItem::data(Qt::DisplayRole);
+    }
+    return ret;
+  }
+
+  QStandardItem* clone() const override { return new JsonItem(*this); }
+
+  int type() const override { return kType; }
+
+ protected:
+  JsonItem(const JsonItem& other) : QStandardItem(other) {}
+};
+}  // namespace
+
 QList<QStandardItem*> toStandardItem(QVariant name, const QJsonValue& json) {
   QList<QList<QStandardItem*>> children;
 
-  QStandardItem* col0 = new QStandardItem;
-  col0->setData(name, Qt::EditRole);
-  col0->setData(name, Qt::DisplayRole);
-  col0->setData(name, Qt::AccessibleTextRole);
+  QStandardItem* col0 = new JsonItem(name);
 
   switch (json.type()) {
     case QJsonValue::Null:
@@ -31,13 +62,8 @@ QList<QStandardItem*> toStandardItem(QVariant name, const QJsonValue& json) {
       break;
     }
 
-    default: {
-      QStandardItem* col1 = new QStandardItem();
-      col1->setData(json, Qt::EditRole);
-      col1->setData(json.toVariant(), Qt::DisplayRole);
-      col1->setData(json.toVariant(), Qt::AccessibleTextRole);
-      return {col0, col1};
-    }
+    default:
+      return {col0, new JsonItem(json.toVariant())};
   }
 
   // Object or array.
@@ -49,10 +75,161 @@ QList<QStandardItem*> toStandardItem(QVariant name, const QJsonValue& json) {
 
 QList<QStandardItem*> toStandardItem(const QJsonValue& json,
                                      const QString& name) {
+  KTUTILS_TRACE_SCOPE("Json::toStandardItem");
   return toStandardItem(name, json);
 }
 
-QJsonValue fromStandardItem(QStandardItem* col0, QStandardItem* col1) {
+/* ======================== Parallel ======================== */
+// Units claimed by a thread at a time.
+static constexpr std::size_t kParallelChunkSize = 64;
+
+namespace {
+// Row of result, built by a thread from json, or split into child rows if
+// the subtree is large.
+struct PlanNode {
+  QVariant name;
+  QJsonValue json;
+  bool split = false;
+  std::vector<PlanNode> children;
+  QList<QStandardItem*> row;
+};
+
+// Units shared by the calling thread and pool threads, each claims next
+// chunk of units until all are claimed.
+struct ParallelBuild {
+  std::vector<PlanNode*> units;
+  std::atomic<std::size_t> next{0};
+  std::atomic<std::size_t> remaining{0};
+  QMutex mutex;
+  QWaitCondition finished;
+
+  void run() {
+    while (true) {
+      const std::size_t begin = next.fetch_add(kParallelChunkSize);
+      if (begin >= units.size()) return;
+      const std::size_t end = qMin(begin + kParallelChunkSize, units.size());
+      for (std::size_t i = begin; i < end; ++i) {
+        units[i]->row = toStandardItem(units[i]->name, units[i]->json);
+      }
+      if (remaining.fetch_sub(end - begin) == (end - begin)) {
+        QMutexLocker locker(&mutex);
+        finished.wakeAll();
+      }
+    }
+  }
+};
+
+// Shares the build, may start after all units are claimed.
+class ParallelBuildRunnable : public QRunnable {
+ public:
+  explicit ParallelBuildRunnable(std::shared_ptr<ParallelBuild> build)
+      : build(std::move(build)) {}
+
+  void run() override { build->run(); }
+
+ private:
+  std::shared_ptr<ParallelBuild> build;
+};
+
+// Count nodes of json, stop counting at limit.
+int CountNodes(const QJsonValue& json, int limit) {
+  int count = 1;
+  if (json.isObject()) {
+    const QJsonObject object = json.toObject();
+    for (auto it = object.constBegin();
+         (it != object.constEnd()) && (count < limit); ++it) {
+      count += CountNodes(it.value(), limit - count);
+    }
+  } else if (json.isArray()) {
+    const QJsonArray array = json.toArray();
+    for (int i = 0; (i < array.size()) && (count < limit); ++i) {
+      count += CountNodes(array.at(i), limit - count);
+    }
+  }
+  return count;
+}
+
+// Split large subtrees, collect the rest as units.
+void Plan(PlanNode* node, int threshold, std::vector<PlanNode*>* units) {
+  if (!(node->json.isObject() || node->json.isArray()) ||
+      (CountNodes(node->json, threshold) < threshold)) {
+    units->push_back(node);
+    return;
+  }
+
+  node->split = true;
+  if (node->json.isObject()) {
+    const QJsonObject object = node->json.toObject();
+    node->children.resize(std::size_t(object.size()));
+    auto child = node->children.begin();
+    for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+      child->name = it.key();
+      child->json = it.value();
+      ++child;
+    }
+  } else {
+    const QJsonArray array = node->json.toArray();
+    node->children.resize(std::size_t(array.size()));
+    for (int i = 0; i < array.size(); ++i) {
+      node->children[std::size_t(i)].name = i;
+      node->children[std::size_t(i)].json = array.at(i);
+    }
+  }
+  // Children are not resized any more, pointers to them are stable.
+  for (PlanNode& child : node->children) {
+    Plan(&child, threshold, units);
+  }
+}
+
+QList<QStandardItem*> Assemble(PlanNode* node) {
+  if (!node->split) return std::move(node->row);
+  QStandardItem* col0 = new JsonItem(node->name);
+  for (PlanNode& child : node->children) {
+    col0->appendRow(Assemble(&child));
+  }
+  return {col0};
+}
+}  // namespace
+
+QList<QStandardItem*> toStandardItem(const QJsonValue& json,
+                                     const QString& name,
+                                     int parallel_threshold,
+                                     QThreadPool* pool) {
+  KTUTILS_TRACE_SCOPE("Json::toStandardItem");
+  PlanNode root;
+  root.name = name;
+  root.json = json;
+  auto build = std::make_shared<ParallelBuild>();
+  Plan(&root, qMax(parallel_threshold, 1), &build->units);
+  if (!root.split) return toStandardItem(root.name, json);
+
+  build->remaining.store(build->units.size());
+  if (!pool) pool = QThreadPool::globalInstance();
+  const std::size_t chunks =
+      (build->units.size() + kParallelChunkSize - 1) / kParallelChunkSize;
+  const int helpers = int(qMin<std::size_t>(
+      std::size_t(qMax(pool->maxThreadCount(), 0)), chunks - 1));
+  for (int i = 0; i < helpers; ++i) {
+    auto runnable = new ParallelBuildRunnable(build);
+    if (!pool->tryStart(runnable)) {
+      delete runnable;
+      break;
+    }
+  }
+
+  // Work with helpers, then wait for units claimed by them.
+  build->run();
+  {
+    QMutexLocker locker(&build->mutex);
+    while (build->remaining.load() > 0) {
+      build->finished.wait(&build->mutex);
+    }
+  }
+  return Assemble(&root);
+}
+/* ======================== Parallel ======================== */
+
+static QJsonValue FromStandardItem(QStandardItem* col0, QStandardItem* col1) {
   if (!col0) return QJsonValue();
   if (!col0->hasChildren()) {
     if (col1) {
@@ -76,7 +253,7 @@ QJsonValue fromStandardItem(QStandardItem* col0, QStandardItem* col1) {
   if (isArray) {
     QJsonArray array;
     for (int row = 0; row < col0->rowCount(); ++row) {
-      array << fromStandardItem(col0->child(row, 0), col0->child(row, 1));
+      array << FromStandardItem(col0->child(row, 0), col0->child(row, 1));
     }
     return array;
   } else {
@@ -85,18 +262,526 @@ QJsonValue fromStandardItem(QStandardItem* col0, QStandardItem* col1) {
       QStandardItem* first = col0->child(rpw, 0);
       QStandardItem* second = col0->child(rpw, 1);
       object[first->data(Qt::DisplayRole).toString()] =
-          fromStandardItem(first, second);
+          FromStandardItem(first, second);
     }
     return object;
   }
 }
 
-bool settingsReadFunc(QIODevice& device, QSettings::SettingsMap& map) {
+QJsonValue fromStandardItem(QStandardItem* col0, QStandardItem* col1) {
+  KTUTILS_TRACE_SCOPE("Json::fromStandardItem");
+  return FromStandardItem(col0, col1);
+}
+
+/* ======================== File ======================== */
+// Bytes read at once from devices which can't be mapped.
+static constexpr qint64 kReadChunkSize = 1 << 20;
+
+static QJsonDocument Parse(const QByteArray& data, QString* errorString) {
   QJsonParseError error;
-  const QJsonDocument doc = QJsonDocument::fromJson(device.readAll(), &error);
+  QJsonDocument doc = QJsonDocument::fromJson(data, &error);
   if (error.error != QJsonParseError::NoError) {
-    qWarning("Json parse error at pos %d: %s", error.offset,
-             error.errorString().toUtf8().constData());
+    if (errorString) {
+      *errorString = QStringLiteral("Json parse error at pos %1: %2")
+                         .arg(error.offset)
+                         .arg(error.errorString());
+    }
+    return {};
+  }
+  return doc;
+}
+
+// Called with bytes read and total bytes, stops reading if returns false.
+using ReadProgress = std::function<bool(qint64, qint64)>;
+
+// Map file devices, or read others in chunks, then parse.
+static QJsonDocument ReadDocument(QIODevice& device, QString* errorString,
+                                  const ReadProgress& progress) {
+  KTUTILS_TRACE_SCOPE("Json::fromDevice");
+  const qint64 pos = device.pos();
+  const qint64 size = device.isSequential() ? 0 : (device.size() - pos);
+  if (progress && !progress(0, size)) return {};
+
+  auto file = qobject_cast<QFileDevice*>(&device);
+  if (file && (size > 0) && (size <= INT_MAX)) {
+    if (uchar* mapped = file->map(pos, size)) {
+      // Pages are read by parsing, mapped size is reported as read.
+      QJsonDocument doc;
+      if (!progress || progress(size, size)) {
+        // Document doesn't refer to the input after parsing.
+        doc = Parse(QByteArray::fromRawData(
+                        reinterpret_cast<const char*>(mapped), int(size)),
+                    errorString);
+      }
+      file->unmap(mapped);
+      file->seek(pos + size);
+      return doc;
+    }
+  }
+
+  // Streaming fallback, reserved at once for random access devices.
+  QByteArray data;
+  if (size > 0) data.reserve(int(qMin(size, qint64(INT_MAX))));
+  for (;;) {
+    const QByteArray chunk = device.read(kReadChunkSize);
+    if (chunk.isEmpty()) break;
+    data += chunk;
+    if (progress && !progress(data.size(), qMax(size, qint64(data.size())))) {
+      return {};
+    }
+  }
+  return Parse(data, errorString);
+}
+
+QJsonDocument fromFile(const QString& path, QString* errorString) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    if (errorString) *errorString = file.errorString();
+    return {};
+  }
+  return fromDevice(file, errorString);
+}
+
+QJsonDocument fromDevice(QIODevice& device, QString* errorString) {
+  return ReadDocument(device, errorString, nullptr);
+}
+/* ======================== File ======================== */
+
+/* ======================== Model ======================== */
+// Rows fetched by each fetchMore().
+static constexpr int kFetchBatchSize = 256;
+
+namespace {
+// Row of Json::Model, created only when fetched.
+struct ModelNode {
+  ModelNode* parent = nullptr;
+  int row = 0;
+  QVariant name;  // Key of object member, or index of array element.
+  QJsonValue value;
+  std::vector<std::unique_ptr<ModelNode>> children;  // Fetched children.
+
+  int childCount() const {
+    if (value.isObject()) return value.toObject().size();
+    if (value.isArray()) return value.toArray().size();
+    return 0;
+  }
+
+  void fetch(int count) {
+    const int begin = int(children.size());
+    if (value.isObject()) {
+      const QJsonObject object = value.toObject();
+      auto it = object.constBegin() + begin;
+      for (int i = 0; i < count; ++i, ++it) {
+        append(it.key(), it.value());
+      }
+    } else if (value.isArray()) {
+      const QJsonArray array = value.toArray();
+      for (int i = begin; i < (begin + count); ++i) {
+        append(i, array.at(i));
+      }
+    }
+  }
+
+  void append(const QVariant& childName, const QJsonValue& childValue) {
+    auto child = std::unique_ptr<ModelNode>(new ModelNode);
+    child->parent = this;
+    child->row = int(children.size());
+    child->name = childName;
+    child->value = childValue;
+    children.push_back(std::move(child));
+  }
+};
+}  // namespace
+
+struct Model::Private {
+  ModelNode root;  // Invisible root, parent of the top level row.
+
+  ModelNode* node(const QModelIndex& index) {
+    return index.isValid() ? static_cast<ModelNode*>(index.internalPointer())
+                           : &root;
+  }
+};
+
+Model::Model(QObject* parent) : QAbstractItemModel(parent), d(new Private) {}
+
+Model::~Model() {}
+
+void Model::setJson(const QJsonValue& json, const QString& name) {
+  beginResetModel();
+  d->root.children.clear();
+  d->root.append(name, json);
+  endResetModel();
+}
+
+QJsonValue Model::json() const {
+  return d->root.children.empty() ? QJsonValue()
+                                  : d->root.children.front()->value;
+}
+
+QJsonValue Model::value(const QModelIndex& index) const {
+  return index.isValid() ? d->node(index)->value : QJsonValue();
+}
+
+QModelIndex Model::index(int row, int column,
+                         const QModelIndex& parent) const {
+  if ((column < 0) || (column >= 2) || (parent.column() > 0)) return {};
+  ModelNode* node = d->node(parent);
+  if ((row < 0) || (row >= int(node->children.size()))) return {};
+  return createIndex(row, column, node->children[row].get());
+}
+
+QModelIndex Model::parent(const QModelIndex& index) const {
+  if (!index.isValid()) return {};
+  ModelNode* parent = d->node(index)->parent;
+  if (!parent || (parent == &d->root)) return {};
+  return createIndex(parent->row, 0, parent);
+}
+
+int Model::rowCount(const QModelIndex& parent) const {
+  if (parent.column() > 0) return 0;
+  return int(d->node(parent)->children.size());
+}
+
+int Model::columnCount(const QModelIndex&) const { return 2; }
+
+bool Model::hasChildren(const QModelIndex& parent) const {
+  if (parent.column() > 0) return false;
+  const ModelNode* node = d->node(parent);
+  return !node->children.empty() || (node->childCount() > 0);
+}
+
+QVariant Model::data(const QModelIndex& index, int role) const {
+  if (!index.isValid()) return {};
+  if ((role != Qt::EditRole) && (role != Qt::DisplayRole) &&
+      (role != Qt::AccessibleTextRole)) {
+    return {};
+  }
+  const ModelNode* node = d->node(index);
+  if (index.column() == 0) return node->name;
+  // Like toStandardItem(), only scalar values have the value column.
+  if (node->value.isObject() || node->value.isArray() ||
+      node->value.isNull()) {
+    return {};
+  }
+  return node->value.toVariant();
+}
+
+bool Model::canFetchMore(const QModelIndex& parent) const {
+  if (parent.column() > 0) return false;
+  const ModelNode* node = d->node(parent);
+  return int(node->children.size()) < node->childCount();
+}
+
+void Model::fetchMore(const QModelIndex& parent) {
+  if (parent.column() > 0) return;
+  ModelNode* node = d->node(parent);
+  const int begin = int(node->children.size());
+  const int count = qMin(node->childCount() - begin, kFetchBatchSize);
+  if (count <= 0) return;
+  beginInsertRows(parent, begin, begin + count - 1);
+  node->fetch(count);
+  endInsertRows();
+}
+/* ======================== Model ======================== */
+
+/* ======================== LoadTask ======================== */
+// Nodes built before the rows are appended to model, children of larger
+// values are built and appended as separate rows.
+static constexpr int kRowBatchNodes = 16384;
+// Minimum interval between progress signals in milliseconds.
+static constexpr int kProgressInterval = 50;
+
+namespace {
+// Rows built in background, deletes rows not taken by model, e.g. when the
+// handle is deleted before the rows are appended.
+struct RowBatch {
+  struct Row {
+    int parent;  // Id of the split row to append to, -1 for model root.
+    int id;      // Id if the row is split and its children follow, or -1.
+    QList<QStandardItem*> items;
+  };
+  QList<Row> rows;
+
+  RowBatch() = default;
+  RowBatch(const RowBatch&) = delete;
+  RowBatch& operator=(const RowBatch&) = delete;
+  ~RowBatch() {
+    for (const Row& row : rows) qDeleteAll(row.items);
+  }
+};
+}  // namespace
+
+struct LoadTask::Private {
+  FuturePromise<bool> state;  // Reported only in thread of handle.
+  std::atomic<qint64> bytesRead{0};
+  std::atomic<qint64> nodesBuilt{0};
+
+  // Guards handle against the worker, which posts only while it's alive.
+  QMutex mutex;
+  LoadTask* handle = nullptr;
+
+  // Accessed only in thread of handle.
+  QString errorString;
+  QPointer<QStandardItemModel> itemModel;
+  QPointer<Model> jsonModel;
+  // Split rows by id, the top level row is the first.
+  std::vector<QPersistentModelIndex> splitRows;
+
+  QModelIndex top() const {
+    return splitRows.empty() ? QModelIndex() : QModelIndex(splitRows.front());
+  }
+
+  void appendRows(RowBatch& batch) {
+    if (!itemModel) {
+      state.promise.cancel();
+      return;
+    }
+    while (!batch.rows.isEmpty()) {
+      const RowBatch::Row row = batch.rows.takeFirst();
+      QStandardItem* parent = itemModel->invisibleRootItem();
+      if (row.parent >= 0) {
+        const QModelIndex index = splitRows[std::size_t(row.parent)];
+        // Row is removed by others.
+        if (!index.isValid()) {
+          qDeleteAll(row.items);
+          state.promise.cancel();
+          return;
+        }
+        parent = itemModel->itemFromIndex(index);
+      } else if (itemModel->columnCount() < 2) {
+        itemModel->setColumnCount(2);
+      }
+      parent->appendRow(row.items);
+      if (row.id >= 0) {
+        if (splitRows.size() <= std::size_t(row.id)) {
+          splitRows.resize(std::size_t(row.id) + 1);
+        }
+        splitRows[std::size_t(row.id)] = row.items.first()->index();
+      }
+    }
+  }
+
+  // Report result, removes rows loaded partially.
+  bool finish(bool success, const QString& error) {
+    if (state.promise.isFinished()) return false;
+    const QModelIndex index = itemModel ? top() : QModelIndex();
+    success = success && !state.promise.isCanceled() &&
+              (itemModel ? index.isValid() : !jsonModel.isNull());
+    if (!success && index.isValid()) {
+      itemModel->removeRow(index.row(), index.parent());
+    }
+    if (state.promise.isCanceled()) {
+      state.promise.reportFinished();
+      return false;
+    }
+    errorString = error;
+    FinishPromise(state.promise, [success] { return success; });
+    return success;
+  }
+};
+
+// Reads, parses and builds in pool thread, posts results to the handle.
+class LoadTaskWorker {
+ public:
+  LoadTaskWorker(LoadTask* handle, const QString& path, bool buildItems)
+      : d(handle->d), path(path), buildItems(buildItems) {}
+
+  // Handle is parented to the model.
+  static LoadTask* start(const QString& path, QStandardItemModel* itemModel,
+                         Model* jsonModel) {
+    QObject* model = itemModel ? static_cast<QObject*>(itemModel) : jsonModel;
+    if (Q_UNLIKELY(!model)) {
+      qWarning() << "Json::loadAsync: model is nullptr";
+      return nullptr;
+    }
+    auto handle = new LoadTask(model);
+    handle->d->itemModel = itemModel;
+    handle->d->jsonModel = jsonModel;
+    auto worker = std::make_shared<LoadTaskWorker>(handle, path, !jsonModel);
+    // Reading and parsing costs about 10ms per MB, keeps threads waiting in
+    // Wait() with short deadlines from taking the task.
+    const double estimate = double(QFileInfo(path).size()) / 1e5;
+    TaskQueue::globalInstance()->post([worker] { worker->run(); }, estimate);
+    return handle;
+  }
+
+  void run() {
+    KTUTILS_TRACE_SCOPE("Json::loadAsync");
+    progressTimer.start();
+    QJsonValue json;
+    bool success = read(&json);
+    if (success) success = buildItems ? build(json) : set(json);
+    json = QJsonValue();
+
+    const QString message = error;
+    post([](LoadTask* handle) {
+      emit handle->progress(handle->bytesRead(), handle->nodesBuilt());
+    });
+    post([success, message](LoadTask* handle) {
+      emit handle->finished(handle->d->finish(success, message));
+    });
+  }
+
+ private:
+  // Run f(handle) in thread of handle, if handle is not deleted.
+  template <typename F>
+  void post(F f) {
+    QMutexLocker locker(&d->mutex);
+    LoadTask* handle = d->handle;
+    if (!handle) return;
+    QMetaObject::invokeMethod(
+        handle, [handle, f]() mutable { f(handle); }, Qt::QueuedConnection);
+  }
+
+  bool isCanceled() const { return d->state.promise.isCanceled(); }
+
+  bool fail(const QString& message) {
+    error = message;
+    return false;
+  }
+
+  // Report at most once in kProgressInterval unless forced.
+  void reportProgress(bool force = false) {
+    if (!force && (progressTimer.elapsed() < kProgressInterval)) return;
+    progressTimer.restart();
+    post([](LoadTask* handle) {
+      emit handle->progress(handle->bytesRead(), handle->nodesBuilt());
+    });
+  }
+
+  // Like fromFile(), checks cancellation and reports bytes read.
+  bool read(QJsonValue* json) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return fail(file.errorString());
+    QString message;
+    const QJsonDocument doc =
+        ReadDocument(file, &message, [this](qint64 bytes, qint64 total) {
+          d->bytesRead.store(bytes);
+          // Mapped file is reported once before parsing.
+          reportProgress(bytes == total);
+          return !isCanceled();
+        });
+    if (isCanceled()) return false;
+    if (doc.isNull()) return fail(message);
+    *json = doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object());
+    return true;
+  }
+
+  // Json::Model builds rows by itself.
+  bool set(const QJsonValue& json) {
+    const QString name = QFileInfo(path).fileName();
+    post([json, name](LoadTask* handle) {
+      if (handle->d->jsonModel) handle->d->jsonModel->setJson(json, name);
+    });
+    return true;
+  }
+
+  // Rows in depth first order, large values are split like Plan() of
+  // parallel toStandardItem(), so rows of their children are appended in
+  // batches too.
+  bool build(const QJsonValue& json) {
+    batch = std::make_shared<RowBatch>();
+    if (!buildRow(-1, QFileInfo(path).fileName(), json)) return false;
+    if (!batch->rows.isEmpty()) flush();
+    return true;
+  }
+
+  bool buildRow(int parent, const QVariant& name, const QJsonValue& json) {
+    if (isCanceled()) return false;
+    const int nodes = CountNodes(json, kRowBatchNodes);
+    // Top level row always has an id, to be removed if loading fails.
+    const bool split = (json.isObject() || json.isArray()) &&
+                       (nodes >= kRowBatchNodes);
+    const int id = (split || (parent < 0)) ? nextId++ : -1;
+    if (!split) {
+      append(RowBatch::Row{parent, id, toStandardItem(name, json)}, nodes);
+      return true;
+    }
+
+    append(RowBatch::Row{parent, id, toStandardItem(name, QJsonValue())}, 1);
+    if (json.isObject()) {
+      const QJsonObject object = json.toObject();
+      for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+        if (!buildRow(id, it.key(), it.value())) return false;
+      }
+    } else {
+      const QJsonArray array = json.toArray();
+      for (int i = 0; i < array.size(); ++i) {
+        if (!buildRow(id, i, array.at(i))) return false;
+      }
+    }
+    return true;
+  }
+
+  void append(RowBatch::Row row, int nodes) {
+    batch->rows << std::move(row);
+    d->nodesBuilt.fetch_add(nodes);
+    batchNodes += nodes;
+    if (batchNodes >= kRowBatchNodes) flush();
+  }
+
+  void flush() {
+    post([batch = std::move(batch)](LoadTask* handle) {
+      handle->d->appendRows(*batch);
+    });
+    batch = std::make_shared<RowBatch>();
+    batchNodes = 0;
+    reportProgress();
+  }
+
+  std::shared_ptr<LoadTask::Private> d;
+  QString path;
+  bool buildItems;
+  QString error;
+  QElapsedTimer progressTimer;
+  std::shared_ptr<RowBatch> batch;  // Rows not posted yet.
+  int batchNodes = 0;
+  int nextId = 0;
+};
+
+LoadTask::LoadTask(QObject* parent)
+    : QObject(parent), d(std::make_shared<Private>()) {
+  d->handle = this;
+}
+
+LoadTask::~LoadTask() {
+  {
+    QMutexLocker locker(&d->mutex);
+    d->handle = nullptr;
+  }
+  // Worker stops at next check, its rows are deleted with posted events.
+  cancel();
+  d->finish(false, {});
+}
+
+void LoadTask::cancel() { d->state.promise.cancel(); }
+
+bool LoadTask::isCanceled() const { return d->state.promise.isCanceled(); }
+
+bool LoadTask::isFinished() const { return d->state.promise.isFinished(); }
+
+QString LoadTask::errorString() const { return d->errorString; }
+
+QFuture<bool> LoadTask::future() const { return d->state.promise.future(); }
+
+qint64 LoadTask::bytesRead() const { return d->bytesRead.load(); }
+
+qint64 LoadTask::nodesBuilt() const { return d->nodesBuilt.load(); }
+
+LoadTask* loadAsync(const QString& path, QStandardItemModel* model) {
+  return LoadTaskWorker::start(path, model, nullptr);
+}
+
+LoadTask* loadAsync(const QString& path, Model* model) {
+  return LoadTaskWorker::start(path, nullptr, model);
+}
+/* ======================== LoadTask ======================== */
+
+bool settingsReadFunc(QIODevice& device, QSettings::SettingsMap& map) {
+  QString errorString;
+  const QJsonDocument doc = fromDevice(device, &errorString);
+  if (doc.isNull()) {
+    qWarning("%s", errorString.toUtf8().constData());
     return false;
   }
   QVariantMap variantMap = doc.object().toVariantMap();
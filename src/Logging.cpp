@@ -0,0 +1,673 @@
+#include <KtUtils/Logging>
+#include <algorithm>
+
+namespace KtUtils {
+/* ======================== LogSink ======================== */
+// Number of placeholder %1 to %99 at i, and its length after '%', or 0.
+static int Placeholder(const QString& text, int i, int* length) {
+  *length = 0;
+  if (text.at(i) != QLatin1Char('%')) return 0;
+  int number = 0;
+  while ((*length < 2) && (i + 1 + *length < text.size()) &&
+         text.at(i + 1 + *length).isDigit()) {
+    number = number * 10 + text.at(i + 1 + *length).digitValue();
+    ++*length;
+  }
+  return number;
+}
+
+QString LogRecord::text() const {
+  if (!format) return message;
+  QStringList values;
+  QDataStream stream(arguments);
+  stream.setVersion(QDataStream::Qt_5_12);
+  while (!stream.atEnd()) {
+    QVariant argument;
+    stream >> argument;
+    if (stream.status() != QDataStream::Ok) break;
+    values << argument.toString();
+  }
+
+  // Substitute in one pass like QString::arg(a1, ..., an): k-th lowest
+  // placeholder is k-th argument, and arguments are not scanned again.
+  const QString text = QString::fromUtf8(format);
+  std::vector<int> numbers;
+  int length = 0;
+  for (int i = 0; i < text.size(); ++i) {
+    const int number = Placeholder(text, i, &length);
+    if (number > 0) numbers.push_back(number);
+  }
+  std::sort(numbers.begin(), numbers.end());
+  numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+
+  QString ret;
+  ret.reserve(text.size());
+  for (int i = 0; i < text.size(); ++i) {
+    const int number = Placeholder(text, i, &length);
+    const auto it = std::lower_bound(numbers.begin(), numbers.end(), number);
+    if ((number > 0) && (int(it - numbers.begin()) < values.size())) {
+      ret += values.at(int(it - numbers.begin()));
+      i += length;
+    } else {
+      ret += text.at(i);
+    }
+  }
+  return ret;
+}
+
+LogSink::~LogSink() {}
+
+void LogSink::flush() {}
+
+QString LogSink::format(const LogRecord& record) {
+  static const char* const kTypes[] = {"debug", "warning", "critical", "fatal",
+                                       "info"};
+  const char* type =
+      (uint(record.type) < (sizeof(kTypes) / sizeof(kTypes[0])))
+          ? kTypes[record.type]
+          : "unknown";
+  const QDateTime time =
+      QDateTime::fromMSecsSinceEpoch(record.timestamp / 1000000);
+  QString ret =
+      QStringLiteral("%1 %2 [%3] ")
+          .arg(time.toString(QStringLiteral("yyyy-MM-dd hh:mm:ss.zzz")),
+               QString::fromLatin1(type), QString::number(record.thread, 16));
+  if (record.category) {
+    ret += QString::fromUtf8(record.category) + QStringLiteral(": ");
+  }
+  ret += record.text();
+  if (record.file) {
+    ret += QStringLiteral(" (%1:%2, %3)")
+               .arg(QString::fromUtf8(record.file))
+               .arg(record.line)
+               .arg(QString::fromUtf8(record.function ? record.function : ""));
+  }
+  return ret;
+}
+
+TextLogSink::TextLogSink(FILE* stream) : stream(stream) {}
+
+void TextLogSink::write(const LogRecord& record) {
+  const QByteArray text = format(record).toLocal8Bit();
+  fwrite(text.constData(), 1, std::size_t(text.size()), stream);
+  fputc('\n', stream);
+}
+
+void TextLogSink::flush() { fflush(stream); }
+/* ======================== LogSink ======================== */
+
+/* ======================== BinaryLogSink ======================== */
+namespace {
+constexpr quint32 kBinaryLogMagic = 0x4B544C47;  // "KTLG"
+constexpr quint32 kBinaryLogVersion = 1;
+constexpr QDataStream::Version kBinaryLogStreamVersion = QDataStream::Qt_5_12;
+
+// Entries of binary log, each starts with a quint8 tag.
+enum BinaryLogTag : quint8 {
+  // quint32 id, QByteArray utf8.
+  kStringTag = 1,
+  // quint8 type, qint64 timestamp, quint64 thread, quint32 category id,
+  // quint32 file id, qint32 line, quint32 function id, quint32 format id,
+  // then QByteArray arguments if format id is not 0, or QByteArray utf8
+  // message.
+  kRecordTag = 2,
+};
+}  // namespace
+
+struct BinaryLogSink::Private {
+  QFile file;
+  QDataStream stream;
+  // Strings identified by content, as the address of a freed string may be
+  // reused by another one. 0 is nullptr.
+  QHash<QByteArray, quint32> ids;
+
+  quint32 intern(const char* string) {
+    if (!string) return 0;
+    const QByteArray key =
+        QByteArray::fromRawData(string, int(qstrlen(string)));
+    auto it = ids.constFind(key);
+    if (it != ids.constEnd()) return it.value();
+    const quint32 id = quint32(ids.size() + 1);
+    // Deep copy, key only refers to the string.
+    ids.insert(QByteArray(key.constData(), key.size()), id);
+    stream << quint8(kStringTag) << id << key;
+    return id;
+  }
+};
+
+BinaryLogSink::BinaryLogSink(const QString& path) : d(new Private) {
+  d->file.setFileName(path);
+  if (Q_UNLIKELY(!d->file.open(QIODevice::WriteOnly | QIODevice::Truncate))) {
+    qWarning() << "BinaryLogSink: failed to open" << path << ":"
+               << d->file.errorString();
+    return;
+  }
+  d->stream.setDevice(&d->file);
+  d->stream.setVersion(kBinaryLogStreamVersion);
+  d->stream << kBinaryLogMagic << kBinaryLogVersion;
+}
+
+BinaryLogSink::~BinaryLogSink() {}
+
+bool BinaryLogSink::isOpen() const { return d->file.isOpen(); }
+
+void BinaryLogSink::write(const LogRecord& record) {
+  if (!d->file.isOpen()) return;
+  // Strings are defined before the record refers them.
+  const quint32 category = d->intern(record.category);
+  const quint32 file = d->intern(record.file);
+  const quint32 function = d->intern(record.function);
+  const quint32 format = d->intern(record.format);
+  d->stream << quint8(kRecordTag) << quint8(record.type)
+            << qint64(record.timestamp) << quint64(record.thread) << category
+            << file << qint32(record.line) << function << format;
+  if (format != 0) {
+    d->stream << record.arguments;
+  } else {
+    d->stream << record.message.toUtf8();
+  }
+}
+
+void BinaryLogSink::flush() { d->file.flush(); }
+
+struct BinaryLogReader::Private {
+  QDataStream stream;
+  bool valid = false;
+  QHash<quint32, QByteArray> strings;
+
+  const char* string(quint32 id) const {
+    auto it = strings.constFind(id);
+    return (it != strings.constEnd()) ? it.value().constData() : nullptr;
+  }
+};
+
+BinaryLogReader::BinaryLogReader(QIODevice* device) : d(new Private) {
+  d->stream.setDevice(device);
+  d->stream.setVersion(kBinaryLogStreamVersion);
+  quint32 magic = 0;
+  quint32 version = 0;
+  d->stream >> magic >> version;
+  d->valid = (d->stream.status() == QDataStream::Ok) &&
+             (magic == kBinaryLogMagic) && (version == kBinaryLogVersion);
+}
+
+BinaryLogReader::~BinaryLogReader() {}
+
+bool BinaryLogReader::isValid() const { return d->valid; }
+
+bool BinaryLogReader::read(LogRecord* record) {
+  if (!d->valid || !record) return false;
+  while (!d->stream.atEnd()) {
+    quint8 tag = 0;
+    d->stream >> tag;
+    if (tag == kStringTag) {
+      quint32 id = 0;
+      QByteArray string;
+      d->stream >> id >> string;
+      d->strings.insert(id, string);
+    } else if (tag == kRecordTag) {
+      quint8 type = 0;
+      qint64 timestamp = 0;
+      quint64 thread = 0;
+      quint32 category = 0, file = 0, function = 0, format = 0;
+      qint32 line = 0;
+      QByteArray data;
+      d->stream >> type >> timestamp >> thread >> category >> file >> line >>
+          function >> format >> data;
+      if (d->stream.status() != QDataStream::Ok) return false;
+      *record = LogRecord();
+      record->type = QtMsgType(type);
+      record->timestamp = timestamp;
+      record->thread = quintptr(thread);
+      record->category = d->string(category);
+      record->file = d->string(file);
+      record->line = line;
+      record->function = d->string(function);
+      record->format = d->string(format);
+      if (record->format) {
+        record->arguments = data;
+      } else {
+        record->message = QString::fromUtf8(data);
+      }
+      return true;
+    } else {
+      return false;
+    }
+    if (d->stream.status() != QDataStream::Ok) return false;
+  }
+  return false;
+}
+/* ======================== BinaryLogSink ======================== */
+
+/* ======================== AsyncMessageHandler ======================== */
+namespace {
+// Interval of background thread checking ring buffers, producers never wake
+// it up to keep logging cheap.
+constexpr unsigned long kWriterInterval = 5;
+constexpr qint64 kFatalFlushTimeout = 1000;
+
+// Single producer single consumer ring buffer, written by logging thread and
+// read by background thread.
+class LogRing {
+ public:
+  explicit LogRing(std::size_t capacity)
+      : slots(capacity), mask(capacity - 1) {}
+
+  bool push(LogRecord&& record) {
+    const std::size_t h = head.load(std::memory_order_relaxed);
+    if ((h - tail.load(std::memory_order_acquire)) > mask) return false;
+    slots[h & mask] = std::move(record);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  void drain(std::vector<LogRecord>* out) {
+    std::size_t t = tail.load(std::memory_order_relaxed);
+    const std::size_t h = head.load(std::memory_order_acquire);
+    for (; t != h; ++t) {
+      out->push_back(std::move(slots[t & mask]));
+    }
+    tail.store(t, std::memory_order_release);
+  }
+
+  std::atomic<bool> closed{false};  // Logging thread exited.
+
+ private:
+  std::vector<LogRecord> slots;
+  const std::size_t mask;
+  // Keep producer and consumer indices in separate cache lines.
+  char padding0[64];
+  std::atomic<std::size_t> head{0};
+  char padding1[64];
+  std::atomic<std::size_t> tail{0};
+};
+
+// Ring buffer of current thread, owned by logger of given id.
+struct RingHolder {
+  quint64 owner = 0;
+  std::shared_ptr<LogRing> ring;
+
+  ~RingHolder() {
+    if (ring) ring->closed.store(true, std::memory_order_release);
+  }
+};
+
+thread_local RingHolder threadRing;
+std::atomic<quint64> nextLoggerId{1};
+
+class AsyncLogger;
+
+class AsyncLogWriter : public QThread {
+ public:
+  explicit AsyncLogWriter(AsyncLogger* logger) : logger(logger) {}
+
+ protected:
+  void run() override;
+
+ private:
+  AsyncLogger* logger;
+};
+
+class AsyncLogger {
+ public:
+  AsyncLogger(std::unique_ptr<LogSink> sink, std::size_t capacity)
+      : id(nextLoggerId.fetch_add(1)),
+        capacity(capacity),
+        sink(std::move(sink)),
+        writer(this) {
+    writer.setObjectName(QStringLiteral("KtUtils::AsyncMessageHandler"));
+  }
+
+  ~AsyncLogger();
+
+  LogRing* currentRing() {
+    RingHolder& holder = threadRing;
+    if (holder.owner != id) {
+      if (holder.ring) holder.ring->closed.store(true);
+      holder.ring = std::make_shared<LogRing>(capacity);
+      holder.owner = id;
+      QMutexLocker locker(&ringsMutex);
+      rings.push_back(holder.ring);
+    }
+    return holder.ring.get();
+  }
+
+  // Write records of all ring buffers, background thread only.
+  void drain();
+  // Wait for background thread to drain records queued before it.
+  void flush(const QDeadlineTimer& deadline);
+  void stop();
+
+  const quint64 id;
+  const std::size_t capacity;
+  std::unique_ptr<LogSink> sink;
+  QMutex sinkMutex;
+  QtMessageHandler previous = nullptr;
+  std::atomic<quint64> dropped{0};
+  quint64 reportedDropped = 0;
+
+  QMutex ringsMutex;
+  std::vector<std::shared_ptr<LogRing>> rings;
+
+  // State of background thread.
+  QMutex mutex;
+  QWaitCondition wake;
+  QWaitCondition flushed;
+  quint64 flushRequested = 0;
+  quint64 flushDone = 0;
+  bool stopping = false;
+  AsyncLogWriter writer;
+};
+
+std::atomic<AsyncLogger*> activeLogger{nullptr};
+
+// Epoch of a thread using the logger loaded from activeLogger, odd while in
+// use. Each thread only writes its own, so logging threads don't contend on
+// a shared counter, and the logger is destroyed only after they are done.
+struct LoggerUse {
+  std::atomic<quint64> epoch{0};
+};
+
+// LoggerUse of all threads, never freed as the logger is destroyed at exit.
+struct LoggerUseRegistry {
+  QMutex mutex;
+  std::vector<std::shared_ptr<LoggerUse>> uses;
+};
+
+LoggerUseRegistry& LoggerUses() {
+  static LoggerUseRegistry* registry = new LoggerUseRegistry;
+  return *registry;
+}
+
+// Registers LoggerUse of current thread until it exits.
+struct LoggerUseHolder {
+  std::shared_ptr<LoggerUse> use = std::make_shared<LoggerUse>();
+  int depth = 0;  // Nested ActiveLogger in current thread.
+
+  LoggerUseHolder() {
+    LoggerUseRegistry& registry = LoggerUses();
+    QMutexLocker locker(&registry.mutex);
+    registry.uses.push_back(use);
+  }
+  ~LoggerUseHolder() {
+    LoggerUseRegistry& registry = LoggerUses();
+    QMutexLocker locker(&registry.mutex);
+    registry.uses.erase(
+        std::remove(registry.uses.begin(), registry.uses.end(), use),
+        registry.uses.end());
+  }
+  LoggerUseHolder(const LoggerUseHolder&) = delete;
+  LoggerUseHolder& operator=(const LoggerUseHolder&) = delete;
+};
+
+thread_local LoggerUseHolder threadUse;
+
+// Loads activeLogger and keeps it alive in its scope.
+class ActiveLogger {
+ public:
+  ActiveLogger() : holder(threadUse) {
+    if (holder.depth++ == 0) {
+      // Published before loading, pairs with destructor of AsyncLogger,
+      // which clears activeLogger before reading epochs.
+      LoggerUse& use = *holder.use;
+      use.epoch.store(use.epoch.load(std::memory_order_relaxed) + 1);
+    }
+    logger = activeLogger.load();
+  }
+  ~ActiveLogger() {
+    if (--holder.depth == 0) {
+      LoggerUse& use = *holder.use;
+      use.epoch.store(use.epoch.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_release);
+    }
+  }
+  ActiveLogger(const ActiveLogger&) = delete;
+  ActiveLogger& operator=(const ActiveLogger&) = delete;
+
+  AsyncLogger* get() const { return logger; }
+
+ private:
+  LoggerUseHolder& holder;
+  AsyncLogger* logger;
+};
+
+// Strings of QMessageLogContext may be temporaries, e.g. of QML or
+// QMessageLogger(qPrintable(...)). Records refer to interned copies, which
+// are kept until exit.
+const char* InternContextString(const char* string) {
+  if (!string) return nullptr;
+  const QByteArray key = QByteArray::fromRawData(string, int(qstrlen(string)));
+  // Lookups of each thread are lock free once interned.
+  thread_local QHash<QByteArray, const char*> cache;
+  auto it = cache.constFind(key);
+  if (it != cache.constEnd()) return it.value();
+
+  static QMutex mutex;
+  static QSet<QByteArray>* strings = new QSet<QByteArray>;  // Never freed.
+  QMutexLocker locker(&mutex);
+  auto interned = strings->constFind(key);
+  if (interned == strings->constEnd()) {
+    interned = strings->insert(QByteArray(key.constData(), key.size()));
+  }
+  // Data of interned strings is never detached or freed.
+  const char* ret = interned->constData();
+  cache.insert(QByteArray::fromRawData(ret, key.size()), ret);
+  return ret;
+}
+
+std::unique_ptr<AsyncLogger>& LoggerStorage() {
+  // Destroyed at exit, which stops background thread.
+  static std::unique_ptr<AsyncLogger> storage;
+  return storage;
+}
+
+qint64 Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+void AsyncLogWriter::run() {
+  QMutexLocker locker(&logger->mutex);
+  while (true) {
+    const quint64 requested = logger->flushRequested;
+    const bool stopping = logger->stopping;
+    locker.unlock();
+    logger->drain();
+    locker.relock();
+    logger->flushDone = requested;
+    logger->flushed.wakeAll();
+    if (stopping) break;
+    if ((logger->flushRequested == requested) && !logger->stopping) {
+      logger->wake.wait(&logger->mutex, kWriterInterval);
+    }
+  }
+}
+
+AsyncLogger::~AsyncLogger() {
+  AsyncLogger* self = this;
+  if (activeLogger.compare_exchange_strong(self, nullptr)) {
+    qInstallMessageHandler(previous);
+  }
+  // Threads which may have loaded the logger before it's cleared, threads
+  // entering later load nullptr, so only current epochs are waited for.
+  std::vector<std::pair<std::shared_ptr<LoggerUse>, quint64>> users;
+  {
+    LoggerUseRegistry& registry = LoggerUses();
+    QMutexLocker locker(&registry.mutex);
+    for (const std::shared_ptr<LoggerUse>& use : registry.uses) {
+      const quint64 epoch = use->epoch.load();
+      if (epoch & 1) users.emplace_back(use, epoch);
+    }
+  }
+  for (const auto& user : users) {
+    while (user.first->epoch.load(std::memory_order_acquire) == user.second) {
+      QThread::yieldCurrentThread();
+    }
+  }
+  stop();
+}
+
+void AsyncLogger::drain() {
+  std::vector<LogRecord> batch;
+  {
+    QMutexLocker locker(&ringsMutex);
+    for (auto it = rings.begin(); it != rings.end();) {
+      // Check before draining, records pushed before closed are drained.
+      const bool closed = (*it)->closed.load(std::memory_order_acquire);
+      (*it)->drain(&batch);
+      it = closed ? rings.erase(it) : (it + 1);
+    }
+  }
+  std::stable_sort(batch.begin(), batch.end(),
+                   [](const LogRecord& a, const LogRecord& b) {
+                     return a.timestamp < b.timestamp;
+                   });
+
+  const quint64 droppedNow = dropped.load(std::memory_order_relaxed);
+  if (batch.empty() && (droppedNow == reportedDropped)) return;
+  QMutexLocker locker(&sinkMutex);
+  for (const LogRecord& record : batch) {
+    sink->write(record);
+  }
+  if (droppedNow != reportedDropped) {
+    LogRecord record;
+    record.type = QtWarningMsg;
+    record.timestamp = Now();
+    record.thread = quintptr(QThread::currentThreadId());
+    record.message =
+        QStringLiteral("%1 log records dropped, ring buffer is full")
+            .arg(droppedNow - reportedDropped);
+    sink->write(record);
+    reportedDropped = droppedNow;
+  }
+  sink->flush();
+}
+
+void AsyncLogger::flush(const QDeadlineTimer& deadline) {
+  // Background thread can't wait for itself, e.g. when sink logs.
+  if (QThread::currentThread() == &writer) return;
+  QMutexLocker locker(&mutex);
+  if (stopping || !writer.isRunning()) return;
+  const quint64 target = ++flushRequested;
+  wake.wakeOne();
+  while ((flushDone < target) && !deadline.hasExpired()) {
+    flushed.wait(&mutex, deadline);
+  }
+}
+
+void AsyncLogger::stop() {
+  {
+    QMutexLocker locker(&mutex);
+    stopping = true;
+    wake.wakeOne();
+  }
+  writer.wait();
+}
+
+// Queue a record, or write it synchronously if fatal.
+void Enqueue(AsyncLogger* logger, LogRecord&& record) {
+  if (record.type == QtFatalMsg) {
+    // Application aborts after return, write everything before it.
+    logger->flush(QDeadlineTimer(kFatalFlushTimeout));
+    QMutexLocker locker(&logger->sinkMutex);
+    logger->sink->write(record);
+    logger->sink->flush();
+    return;
+  }
+  if (!logger->currentRing()->push(std::move(record))) {
+    logger->dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void AsyncMessageHandler(QtMsgType type, const QMessageLogContext& context,
+                         const QString& message) {
+  const ActiveLogger logger;
+  if (!logger.get()) return;
+
+  LogRecord record;
+  record.type = type;
+  record.timestamp = Now();
+  record.thread = quintptr(QThread::currentThreadId());
+  record.category = InternContextString(context.category);
+  record.file = InternContextString(context.file);
+  record.line = context.line;
+  record.function = InternContextString(context.function);
+  record.message = message;
+  Enqueue(logger.get(), std::move(record));
+}
+}  // namespace
+
+void installAsyncMessageHandler(std::unique_ptr<LogSink> sink, int capacity) {
+  uninstallAsyncMessageHandler();
+  if (!sink) sink.reset(new TextLogSink);
+  std::size_t size = 1;
+  while (size < std::size_t(qMax(capacity, 1))) {
+    size <<= 1;
+  }
+
+  std::unique_ptr<AsyncLogger>& storage = LoggerStorage();
+  storage.reset(new AsyncLogger(std::move(sink), size));
+  storage->writer.start();
+  activeLogger.store(storage.get(), std::memory_order_release);
+  storage->previous = qInstallMessageHandler(AsyncMessageHandler);
+}
+
+void uninstallAsyncMessageHandler() { LoggerStorage().reset(); }
+
+void flushAsyncMessages() {
+  const ActiveLogger logger;
+  if (logger.get()) {
+    logger.get()->flush(QDeadlineTimer(QDeadlineTimer::Forever));
+  }
+}
+
+quint64 droppedAsyncMessages() {
+  const ActiveLogger logger;
+  return logger.get() ? logger.get()->dropped.load() : 0;
+}
+
+void LogArguments(QtMsgType type, const char* file, int line,
+                  const char* function, const char* format,
+                  QByteArray arguments) {
+  LogRecord record;
+  record.type = type;
+  record.timestamp = Now();
+  record.thread = quintptr(QThread::currentThreadId());
+  record.category = "default";
+  record.file = file;
+  record.line = line;
+  record.function = function;
+  record.format = format;
+  record.arguments = std::move(arguments);
+
+  // Fatal messages go through Qt, which aborts after handling them.
+  if (type != QtFatalMsg) {
+    const ActiveLogger logger;
+    if (logger.get()) {
+      Enqueue(logger.get(), std::move(record));
+      return;
+    }
+  }
+  // Format now for Qt's message handler.
+  const QMessageLogger messageLogger(file, line, function);
+  const QByteArray text = record.text().toUtf8();
+  switch (type) {
+    case QtDebugMsg:
+      messageLogger.debug("%s", text.constData());
+      break;
+    case QtInfoMsg:
+      messageLogger.info("%s", text.constData());
+      break;
+    case QtWarningMsg:
+      messageLogger.warning("%s", text.constData());
+      break;
+    case QtCriticalMsg:
+      messageLogger.critical("%s", text.constData());
+      break;
+    case QtFatalMsg:
+      messageLogger.fatal("%s", text.constData());
+  }
+}
+/* ======================== AsyncMessageHandler ======================== */
+}  // namespace KtUtils
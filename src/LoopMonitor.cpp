@@ -0,0 +1,220 @@
+#include <KtUtils/LoopMonitor>
+#include "EventHook_p.hpp"
+
+namespace KtUtils {
+static const QEvent::Type kProbeEvent =
+    QEvent::Type(QEvent::registerEventType());
+
+namespace {
+class ProbeEvent : public QEvent {
+ public:
+  explicit ProbeEvent(qint64 postTime)
+      : QEvent(kProbeEvent), postTime(postTime) {}
+
+  const qint64 postTime;
+};
+}  // namespace
+
+struct LoopMonitor::Private {
+  QElapsedTimer clock;
+  double stallThreshold = 100;
+  QTimer* probeTimer = nullptr;
+  QMetaObject::Connection awakeConnection;
+  QMetaObject::Connection blockConnection;
+  // Cleared by stop() in any thread, hook of monitored thread drops state
+  // when it finds it cleared.
+  std::atomic<bool> active{false};
+
+  Histogram iterationTime;
+  Histogram dispatchLatency;
+  std::atomic<qint64> longestIteration{0};
+
+  // Touched only in monitored thread.
+  qint64 iterationStart = -1;
+  int eventType = QEvent::None;  // Current event, None if closed.
+  const char* eventClass = nullptr;
+  qint64 eventStart = 0;
+  int worstType = QEvent::None;  // Slowest event of current iteration.
+  const char* worstClass = nullptr;
+  qint64 worstTime = -1;
+
+  // Attribute time since current event is delivered to it.
+  void closeEvent(qint64 now) {
+    if (eventType == QEvent::None) return;
+    if (now - eventStart > worstTime) {
+      worstTime = now - eventStart;
+      worstType = eventType;
+      worstClass = eventClass;
+    }
+    eventType = QEvent::None;
+  }
+};
+
+class LoopMonitorHook {
+ public:
+  // State of monitor of current thread, shared so that a monitor destroyed
+  // in another thread doesn't leave it dangling.
+  static thread_local std::shared_ptr<LoopMonitor::Private> current;
+
+  // Per event timing relies on the shared event hook, it's a thread local
+  // check in threads without monitor.
+  static void install() { EventHook::Add(&LoopMonitorHook::notify); }
+
+  // Called by QCoreApplication before delivering each event.
+  static void notify(const QObject* receiver, const QEvent* event) {
+    LoopMonitor::Private* d = current.get();
+    if (!d) return;
+    if (!d->active.load(std::memory_order_acquire)) {
+      // Stopped, maybe in another thread.
+      current.reset();
+      return;
+    }
+    const qint64 now = d->clock.nsecsElapsed();
+    d->closeEvent(now);
+    d->eventType = event->type();
+    // Class name lives in static meta object, safe after receiver deleted.
+    d->eventClass = receiver->metaObject()->className();
+    d->eventStart = now;
+  }
+
+  static void awake(LoopMonitor* monitor) {
+    LoopMonitor::Private* d = monitor->d.get();
+    d->iterationStart = d->clock.nsecsElapsed();
+    d->eventType = QEvent::None;
+    d->worstType = QEvent::None;
+    d->worstClass = nullptr;
+    d->worstTime = -1;
+  }
+
+  static void aboutToBlock(LoopMonitor* monitor) {
+    LoopMonitor::Private* d = monitor->d.get();
+    if (d->iterationStart < 0) return;
+    const qint64 now = d->clock.nsecsElapsed();
+    d->closeEvent(now);
+    const qint64 duration = now - d->iterationStart;
+    d->iterationStart = -1;
+    d->iterationTime.record(duration);
+    qint64 longest = d->longestIteration.load(std::memory_order_relaxed);
+    while ((duration > longest) &&
+           !d->longestIteration.compare_exchange_weak(longest, duration)) {
+    }
+    if (duration >= d->stallThreshold * 1e6) {
+      emit monitor->stallDetected(
+          duration / 1e6, d->worstType,
+          QString::fromLatin1(d->worstClass ? d->worstClass : ""));
+    }
+  }
+};
+
+thread_local std::shared_ptr<LoopMonitor::Private> LoopMonitorHook::current;
+
+LoopMonitor::LoopMonitor(QObject* parent) : QObject(parent), d(new Private) {
+  d->clock.start();
+  d->probeTimer = new QTimer(this);
+  d->probeTimer->setInterval(100);
+  connect(d->probeTimer, &QTimer::timeout, this, [this] {
+    QCoreApplication::postEvent(this, new ProbeEvent(d->clock.nsecsElapsed()),
+                                Qt::LowEventPriority);
+  });
+}
+
+LoopMonitor::~LoopMonitor() {
+  stop();
+  // Timer can't be stopped in another thread, it's deleted in its own.
+  if (d->probeTimer->thread() != QThread::currentThread()) {
+    d->probeTimer->setParent(nullptr);
+    d->probeTimer->deleteLater();
+  }
+}
+
+void LoopMonitor::start() {
+  if (d->active) return;
+  if (Q_UNLIKELY(thread() != QThread::currentThread())) {
+    qWarning() << "LoopMonitor::start: monitor lives in another thread";
+    return;
+  }
+  std::shared_ptr<Private>& current = LoopMonitorHook::current;
+  if (Q_UNLIKELY(current && current->active.load())) {
+    qWarning() << "LoopMonitor::start: thread is already monitored";
+    return;
+  }
+  QAbstractEventDispatcher* dispatcher =
+      QAbstractEventDispatcher::instance(thread());
+  if (Q_UNLIKELY(!dispatcher)) {
+    qWarning() << "LoopMonitor::start: thread has no event dispatcher";
+    return;
+  }
+
+  LoopMonitorHook::install();
+  current = d;
+  d->active.store(true, std::memory_order_release);
+  d->iterationStart = -1;
+  d->awakeConnection =
+      connect(dispatcher, &QAbstractEventDispatcher::awake, this,
+              [this] { LoopMonitorHook::awake(this); }, Qt::DirectConnection);
+  d->blockConnection = connect(
+      dispatcher, &QAbstractEventDispatcher::aboutToBlock, this,
+      [this] { LoopMonitorHook::aboutToBlock(this); }, Qt::DirectConnection);
+  d->probeTimer->start();
+}
+
+// May be called in another thread by destructor, so thread local state of
+// monitored thread is left to its hook.
+void LoopMonitor::stop() {
+  if (!d->active.exchange(false)) return;
+  if (LoopMonitorHook::current == d) LoopMonitorHook::current.reset();
+  disconnect(d->awakeConnection);
+  disconnect(d->blockConnection);
+  if (d->probeTimer->thread() == QThread::currentThread()) {
+    d->probeTimer->stop();
+  } else {
+    QMetaObject::invokeMethod(d->probeTimer, "stop", Qt::QueuedConnection);
+  }
+}
+
+bool LoopMonitor::isActive() const { return d->active; }
+
+double LoopMonitor::stallThreshold() const { return d->stallThreshold; }
+
+void LoopMonitor::setStallThreshold(double threshold_milliseconds) {
+  d->stallThreshold = qMax(threshold_milliseconds, 0.0);
+}
+
+int LoopMonitor::probeInterval() const { return d->probeTimer->interval(); }
+
+void LoopMonitor::setProbeInterval(int interval_milliseconds) {
+  d->probeTimer->setInterval(qMax(interval_milliseconds, 1));
+}
+
+const Histogram& LoopMonitor::iterationTime() const {
+  return d->iterationTime;
+}
+
+const Histogram& LoopMonitor::dispatchLatency() const {
+  return d->dispatchLatency;
+}
+
+qint64 LoopMonitor::longestIteration() const {
+  return d->longestIteration.load();
+}
+
+void LoopMonitor::reset() {
+  d->iterationTime.reset();
+  d->dispatchLatency.reset();
+  d->longestIteration.store(0);
+}
+
+QJsonObject LoopMonitor::toJson() const {
+  return QJsonObject{
+      {QStringLiteral("iterationTime"), d->iterationTime.toJson()},
+      {QStringLiteral("dispatchLatency"), d->dispatchLatency.toJson()},
+      {QStringLiteral("longestIteration"), double(longestIteration())}};
+}
+
+bool LoopMonitor::event(QEvent* event) {
+  if (event->type() != kProbeEvent) return QObject::event(event);
+  const auto probe = static_cast<ProbeEvent*>(event);
+  d->dispatchLatency.record(d->clock.nsecsElapsed() - probe->postTime);
+  return true;
+}
+}  // namespace KtUtils
@@ -1,18 +1,22 @@
 ﻿#include "Settings_p.hpp"
 #include <KtUtils/Json>
 #include <KtUtils/Settings>
+#include <KtUtils/Trace>
 
 namespace KtUtils {
 namespace SettingsExtra {
 bool jsonReadFunc(QIODevice& device, QSettings::SettingsMap& map) {
+  KTUTILS_TRACE_SCOPE("Settings::jsonReadFunc");
   return ::KtUtils::Json::settingsReadFunc(device, map);
 }
 
 bool jsonWriteFunc(QIODevice& device, const QSettings::SettingsMap& map) {
+  KTUTILS_TRACE_SCOPE("Settings::jsonWriteFunc");
   return ::KtUtils::Json::settingsWriteFunc(device, map);
 }
 
 bool xmlReadFunc(QIODevice& device, QSettings::SettingsMap& map) {
+  KTUTILS_TRACE_SCOPE("Settings::xmlReadFunc");
   QXmlStreamReader xml(&device);
   std::function<QVariant()> readNextValue = [&readNextValue,
                                              &xml]() -> QVariant {
@@ -67,6 +71,7 @@ bool xmlReadFunc(QIODevice& device, QSettings::SettingsMap& map) {
 }
 
 bool xmlWriteFunc(QIODevice& device, const QSettings::SettingsMap& map) {
+  KTUTILS_TRACE_SCOPE("Settings::xmlWriteFunc");
   QXmlStreamWriter xml(&device);
   xml.setAutoFormatting(true);
   xml.setAutoFormattingIndent(2);
@@ -0,0 +1,92 @@
+#include <KtUtils/TaskQueue>
+#include <deque>
+
+namespace KtUtils {
+struct TaskQueue::Private {
+  struct Item {
+    Task task;
+    double estimate;
+  };
+
+  explicit Private(QThreadPool* threadPool) : pool(threadPool) {}
+
+  // Take the oldest task with estimate in bound, or null task if not found.
+  // Unknown estimate is infinity, only in infinite bound.
+  Task take(double maxEstimate) {
+    QMutexLocker locker(&mutex);
+    auto it = std::find_if(items.begin(), items.end(),
+                           [maxEstimate](const Item& item) {
+                             return item.estimate <= maxEstimate;
+                           });
+    if (it == items.end()) return {};
+    Task task = std::move(it->task);
+    items.erase(it);
+    return task;
+  }
+
+  QThreadPool* pool;
+  mutable QMutex mutex;
+  std::deque<Item> items;
+};
+
+// Run one task of the queue in pool thread, may find nothing if the task is
+// already taken by a waiting thread.
+class TaskQueueRunnable : public QRunnable {
+ public:
+  explicit TaskQueueRunnable(std::shared_ptr<TaskQueue::Private> queue)
+      : d(std::move(queue)) {}
+
+  void run() override {
+    TaskQueue::Task task = d->take(std::numeric_limits<double>::infinity());
+    if (task) task();
+  }
+
+ private:
+  std::shared_ptr<TaskQueue::Private> d;
+};
+
+TaskQueue::TaskQueue(QThreadPool* pool)
+    : d(std::make_shared<Private>(pool)) {}
+
+TaskQueue::TaskQueue(CustomQueue) : d(nullptr) {}
+
+TaskQueue::~TaskQueue() {
+  if (!d) return;
+  // Pending runnables find nothing to run.
+  QMutexLocker locker(&d->mutex);
+  d->items.clear();
+}
+
+TaskQueue* TaskQueue::globalInstance() {
+  static TaskQueue instance(QThreadPool::globalInstance());
+  return &instance;
+}
+
+void TaskQueue::post(Task task, double estimate_milliseconds) {
+  if (Q_UNLIKELY(!task)) {
+    qWarning() << "TaskQueue::post: task is empty";
+    return;
+  }
+  {
+    QMutexLocker locker(&d->mutex);
+    // NaN is unknown too.
+    const double estimate = qIsNaN(estimate_milliseconds)
+                                ? std::numeric_limits<double>::infinity()
+                                : qMax(estimate_milliseconds, 0.0);
+    d->items.push_back(Private::Item{std::move(task), estimate});
+  }
+  if (d->pool) d->pool->start(new TaskQueueRunnable(d));
+}
+
+bool TaskQueue::runOne(double max_estimate_milliseconds) {
+  Task task = d->take(max_estimate_milliseconds);
+  if (!task) return false;
+  task();
+  return true;
+}
+
+int TaskQueue::pendingCount() const {
+  QMutexLocker locker(&d->mutex);
+  return int(d->items.size());
+}
+}  // namespace KtUtils
@@ -0,0 +1,263 @@
+#include "TimerWheel_p.hpp"
+#include <KtUtils/TimerWheel>
+
+namespace KtUtils {
+namespace TimerWheelExtra {
+Wheel::Wheel() { std::fill(std::begin(heads), std::end(heads), kNil); }
+
+void Wheel::reset(quint64 tick) {
+  if (pending == 0) currentTick = tick;
+}
+
+TimerWheel::TimerId Wheel::add(quint64 expires,
+                               std::function<void(void)> callback) {
+  const int index = allocate();
+  Node& node = nodes[index];
+  node.expires = qMax(expires, currentTick + 1);
+  node.callback = std::move(callback);
+  link(index);
+  return (TimerId(node.generation) << 32) | quint32(index);
+}
+
+bool Wheel::cancel(TimerId id) {
+  const int index = find(id);
+  if (index == kNil) return false;
+  unlink(index);
+  release(index);
+  return true;
+}
+
+int Wheel::level(TimerId id) const {
+  const int index = find(id);
+  return (index == kNil) ? kNil : (nodes[index].slot / kSlotCount);
+}
+
+quint64 Wheel::nextTick() const {
+  quint64 next = std::numeric_limits<quint64>::max();
+  if (levelCounts[0] > 0) {
+    for (quint64 tick = currentTick + 1; tick <= currentTick + kSlotCount;
+         ++tick) {
+      if (heads[tick & (kSlotCount - 1)] != kNil) {
+        next = tick;
+        break;
+      }
+    }
+  }
+  for (int level = 1; level < kLevelCount; ++level) {
+    if (levelCounts[level] == 0) continue;
+    const int shift = kLevelBits * level;
+    for (quint64 block = (currentTick >> shift) + 1;
+         block <= (currentTick >> shift) + kSlotCount; ++block) {
+      if (heads[level * kSlotCount + int(block & (kSlotCount - 1))] != kNil) {
+        next = qMin(next, block << shift);
+        break;
+      }
+    }
+  }
+  return next;
+}
+
+void Wheel::advance(quint64 tick) {
+  while (currentTick < tick) {
+    if (pending == 0) {
+      currentTick = tick;
+      break;
+    }
+    currentTick = qMin(tick, nextTick());
+    for (int level = kLevelCount - 1; level > 0; --level) {
+      const int shift = kLevelBits * level;
+      if ((currentTick & ((quint64(1) << shift) - 1)) == 0) {
+        cascade(level * kSlotCount +
+                int((currentTick >> shift) & (kSlotCount - 1)));
+      }
+    }
+    // Slot is computed each time, callbacks may process events and
+    // advance the wheel recursively.
+    int index;
+    while ((index = heads[currentTick & (kSlotCount - 1)]) != kNil) {
+      std::function<void(void)> callback = std::move(nodes[index].callback);
+      unlink(index);
+      release(index);
+      if (callback) callback();
+    }
+  }
+}
+
+int Wheel::allocate() {
+  if (freeList == kNil) {
+    nodes.emplace_back();
+    return int(nodes.size() - 1);
+  }
+  const int index = freeList;
+  freeList = nodes[index].next;
+  return index;
+}
+
+void Wheel::release(int index) {
+  Node& node = nodes[index];
+  node.callback = nullptr;
+  ++node.generation;
+  node.next = freeList;
+  freeList = index;
+}
+
+void Wheel::link(int index) {
+  Node& node = nodes[index];
+  const quint64 delta = qMax(node.expires, currentTick) - currentTick;
+  int level = 0;
+  while ((level < (kLevelCount - 1)) &&
+         (delta >= (quint64(1) << (kLevelBits * (level + 1))))) {
+    ++level;
+  }
+  const quint64 at = (delta >= kMaxTicks) ? (currentTick + kMaxTicks - 1)
+                                          : qMax(node.expires, currentTick);
+  const int slot = level * kSlotCount +
+                   int((at >> (kLevelBits * level)) & (kSlotCount - 1));
+
+  node.slot = slot;
+  node.prev = kNil;
+  node.next = heads[slot];
+  if (node.next != kNil) nodes[node.next].prev = index;
+  heads[slot] = index;
+  ++levelCounts[level];
+  ++pending;
+}
+
+void Wheel::unlink(int index) {
+  Node& node = nodes[index];
+  if (node.prev != kNil) {
+    nodes[node.prev].next = node.next;
+  } else {
+    heads[node.slot] = node.next;
+  }
+  if (node.next != kNil) nodes[node.next].prev = node.prev;
+  --levelCounts[node.slot / kSlotCount];
+  --pending;
+  node.slot = kNil;
+}
+
+void Wheel::cascade(int slot) {
+  int index = heads[slot];
+  while (index != kNil) {
+    const int next = nodes[index].next;
+    unlink(index);
+    link(index);
+    index = next;
+  }
+}
+
+int Wheel::find(TimerId id) const {
+  const quint32 index = quint32(id & 0xFFFFFFFF);
+  if (index >= nodes.size()) return kNil;
+  const Node& node = nodes[index];
+  if ((node.generation != quint32(id >> 32)) || (node.slot == kNil)) {
+    return kNil;
+  }
+  return int(index);
+}
+}  // namespace TimerWheelExtra
+
+struct TimerWheel::Private {
+  qint64 resolution;  // Nanoseconds of a tick.
+  QElapsedTimer clock;
+  TimerWheelExtra::Wheel wheel;
+  QTimer timer;
+  quint64 wakeTick = 0;  // Tick timer wakes up at, all timers expire later.
+
+  explicit Private(int resolution_milliseconds)
+      : resolution(qint64(qMax(resolution_milliseconds, 1)) * 1000000) {
+    clock.start();
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&timer, &QTimer::timeout, &timer, [this] { expire(); });
+  }
+
+  quint64 nowTick() const { return quint64(clock.nsecsElapsed() / resolution); }
+
+  void wakeUpAt(quint64 tick) {
+    wakeTick = tick;
+    const qint64 nsecs = qint64(tick) * resolution - clock.nsecsElapsed();
+    timer.start(int(qBound<qint64>(0, (nsecs + 999999) / 1000000,
+                                   std::numeric_limits<int>::max())));
+  }
+
+  void expire() {
+    wheel.advance(nowTick());
+    if (wheel.count() > 0) {
+      wakeUpAt(wheel.nextTick());
+    } else {
+      timer.stop();
+    }
+  }
+
+  TimerId add(qint64 dueNSecs, std::function<void(void)> callback) {
+    wheel.reset(nowTick());
+    // Round up, so that timers never expire early.
+    const quint64 expires =
+        qMax(quint64((dueNSecs + resolution - 1) / resolution),
+             wheel.current() + 1);
+    const TimerId id = wheel.add(expires, std::move(callback));
+    if (!timer.isActive() || (expires < wakeTick)) wakeUpAt(expires);
+    return id;
+  }
+};
+
+TimerWheel::TimerWheel(int resolution_milliseconds)
+    : d(new Private(resolution_milliseconds)) {}
+
+TimerWheel::~TimerWheel() {}
+
+// Owned by thread storage, others only get weak handles.
+static std::shared_ptr<TimerWheel>& ThreadWheel() {
+  static QThreadStorage<std::shared_ptr<TimerWheel>> wheels;
+  std::shared_ptr<TimerWheel>& wheel = wheels.localData();
+  if (!wheel) wheel = std::make_shared<TimerWheel>();
+  return wheel;
+}
+
+TimerWheel* TimerWheel::instance() { return ThreadWheel().get(); }
+
+std::weak_ptr<TimerWheel> TimerWheel::instanceHandle() {
+  return ThreadWheel();
+}
+
+int TimerWheel::resolution() const { return int(d->resolution / 1000000); }
+
+void TimerWheel::setResolution(int resolution_milliseconds) {
+  if (Q_UNLIKELY(d->wheel.count() > 0)) {
+    qWarning() << "TimerWheel::setResolution: timers are pending";
+    return;
+  }
+  d->resolution = qint64(qMax(resolution_milliseconds, 1)) * 1000000;
+  d->wheel.reset(d->nowTick());
+}
+
+TimerWheel::TimerId TimerWheel::schedule(double timeout_milliseconds,
+                                         std::function<void(void)> callback) {
+  // Limit to about 30 years to avoid overflow.
+  const double nsecs = qBound(0.0, timeout_milliseconds * 1e6, 1e18);
+  return d->add(d->clock.nsecsElapsed() + qint64(nsecs), std::move(callback));
+}
+
+TimerWheel::TimerId TimerWheel::schedule(const QDeadlineTimer& deadline,
+                                         std::function<void(void)> callback) {
+  if (Q_UNLIKELY(deadline.isForever())) {
+    qWarning() << "TimerWheel::schedule: deadline never expires";
+    return 0;
+  }
+  return schedule(double(deadline.remainingTimeNSecs()) / 1e6,
+                  std::move(callback));
+}
+
+bool TimerWheel::cancel(TimerId id) {
+  if (!d->wheel.cancel(id)) return false;
+  if (d->wheel.count() == 0) d->timer.stop();
+  return true;
+}
+
+bool TimerWheel::isPending(TimerId id) const {
+  return d->wheel.isPending(id);
+}
+
+int TimerWheel::pendingCount() const { return d->wheel.count(); }
+}  // namespace KtUtils
@@ -0,0 +1,72 @@
+#pragma once
+#ifndef KTUTILS_TIMERWHEEL_P_HPP
+#define KTUTILS_TIMERWHEEL_P_HPP
+
+#include <KtUtils/TimerWheel.hpp>
+
+namespace KtUtils {
+namespace TimerWheelExtra {
+static constexpr int kLevelBits = 6;
+static constexpr int kSlotCount = 1 << kLevelBits;
+static constexpr int kLevelCount = 4;
+// Timers beyond the range are parked in the last level and relinked later.
+static constexpr quint64 kMaxTicks = quint64(1) << (kLevelBits * kLevelCount);
+static constexpr int kNil = -1;
+
+// Levels and slots of TimerWheel counted in ticks, without clock or QTimer,
+// so tests can drive it in virtual time. Exported for those tests.
+class KTUTILS_EXPORT Wheel {
+ public:
+  using TimerId = TimerWheel::TimerId;
+
+  Wheel();
+
+  // All ticks before and at it are processed.
+  quint64 current() const { return currentTick; }
+  // Move current tick of an empty wheel.
+  void reset(quint64 tick);
+  int count() const { return pending; }
+
+  // Invoke callback at given tick, at least the tick after current one.
+  TimerId add(quint64 expires, std::function<void(void)> callback);
+  bool cancel(TimerId id);
+  bool isPending(TimerId id) const { return find(id) != kNil; }
+  // Level the timer is linked in, kNil if not pending.
+  int level(TimerId id) const;
+
+  // First tick after current tick when a slot expires or cascades.
+  quint64 nextTick() const;
+  // Process all ticks until given tick, skip ticks with nothing to do.
+  void advance(quint64 tick);
+
+ private:
+  struct Node {
+    quint64 expires = 0;  // Tick to expire at.
+    std::function<void(void)> callback;
+    quint32 generation = 1;  // Increased each time the node is released.
+    int slot = kNil;         // Slot linked in, kNil if not pending.
+    int prev = kNil;
+    int next = kNil;  // Next node in slot, or next free node.
+  };
+
+  int allocate();
+  void release(int index);
+  // Link node into the slot matching its distance to current tick.
+  void link(int index);
+  void unlink(int index);
+  // Move timers of given slot into lower levels.
+  void cascade(int slot);
+  // Index of pending node for given id, or kNil.
+  int find(TimerId id) const;
+
+  quint64 currentTick = 0;
+  std::vector<Node> nodes;
+  int freeList = kNil;
+  int heads[kLevelCount * kSlotCount];
+  int levelCounts[kLevelCount] = {};
+  int pending = 0;
+};
+}  // namespace TimerWheelExtra
+}  // namespace KtUtils
+
+#endif  // KTUTILS_TIMERWHEEL_P_HPP
@@ -0,0 +1,118 @@
+#include <KtUtils/Trace>
+#include "Trace_p.hpp"
+
+namespace KtUtils {
+using TraceExtra::Registry;
+using TraceExtra::Span;
+using TraceExtra::ThreadBuffer;
+
+Registry& Registry::instance() {
+  static Registry registry;
+  return registry;
+}
+
+namespace {
+std::atomic<bool> traceEnabled{true};
+thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+
+ThreadBuffer* CurrentBuffer() {
+  if (!threadBuffer) {
+    Registry& registry = Registry::instance();
+    QMutexLocker locker(&registry.mutex);
+    auto buffer =
+        std::make_shared<ThreadBuffer>(std::size_t(registry.bufferCapacity));
+    buffer->thread = quintptr(QThread::currentThreadId());
+    QThread* thread = QThread::currentThread();
+    buffer->threadName = thread->objectName();
+    if (buffer->threadName.isEmpty()) {
+      const QCoreApplication* app = QCoreApplication::instance();
+      buffer->threadName = (app && (app->thread() == thread))
+                               ? QStringLiteral("Main")
+                               : QStringLiteral("Thread %1").arg(
+                                     buffer->thread, 0, 16);
+    }
+    registry.buffers.push_back(buffer);
+    threadBuffer = std::move(buffer);
+  }
+  return threadBuffer.get();
+}
+}  // namespace
+
+/* ======================== TraceScope ======================== */
+TraceScope::TraceScope(const char* name) : name(name), start(-1) {
+  if (Trace::isEnabled()) start = Registry::instance().now();
+}
+
+TraceScope::~TraceScope() {
+  if (start < 0) return;
+  const qint64 end = Registry::instance().now();
+  CurrentBuffer()->push(Span{name, start, end - start});
+}
+/* ======================== TraceScope ======================== */
+
+/* ======================== Trace ======================== */
+void Trace::setEnabled(bool enabled) { traceEnabled.store(enabled); }
+
+bool Trace::isEnabled() {
+  return traceEnabled.load(std::memory_order_relaxed);
+}
+
+int Trace::bufferCapacity() {
+  Registry& registry = Registry::instance();
+  QMutexLocker locker(&registry.mutex);
+  return registry.bufferCapacity;
+}
+
+void Trace::setBufferCapacity(int capacity) {
+  Registry& registry = Registry::instance();
+  QMutexLocker locker(&registry.mutex);
+  registry.bufferCapacity = qMax(capacity, 1);
+}
+
+void Trace::clear() {
+  Registry& registry = Registry::instance();
+  QMutexLocker locker(&registry.mutex);
+  for (auto it = registry.buffers.begin(); it != registry.buffers.end();) {
+    // Only owned by registry after thread exited.
+    if (it->use_count() == 1) {
+      it = registry.buffers.erase(it);
+      continue;
+    }
+    QMutexLocker bufferLocker(&(*it)->mutex);
+    (*it)->spans.clear();
+    (*it)->next = 0;
+    ++it;
+  }
+}
+
+QJsonObject Trace::toChromeTrace() {
+  Registry& registry = Registry::instance();
+  TraceExtra::ChromeTraceWriter writer;
+  QMutexLocker locker(&registry.mutex);
+  for (const auto& buffer : registry.buffers) {
+    QMutexLocker bufferLocker(&buffer->mutex);
+    writer.addThread(buffer->thread, buffer->threadName);
+    // Oldest span first.
+    const std::size_t count = buffer->spans.size();
+    for (std::size_t i = 0; i < count; ++i) {
+      const Span& span = buffer->spans[(buffer->next + i) % count];
+      writer.addSpan(QString::fromUtf8(span.name), QStringLiteral("KtUtils"),
+                     span.start, span.duration, buffer->thread);
+    }
+  }
+  return writer.toJson();
+}
+
+bool Trace::writeChromeTrace(const QString& path) {
+  QFile file(path);
+  if (Q_UNLIKELY(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))) {
+    qWarning() << "Trace::writeChromeTrace: failed to open" << path << ":"
+               << file.errorString();
+    return false;
+  }
+  const QByteArray json =
+      QJsonDocument(toChromeTrace()).toJson(QJsonDocument::Compact);
+  return file.write(json) == json.size();
+}
+/* ======================== Trace ======================== */
+}  // namespace KtUtils
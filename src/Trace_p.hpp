@@ -0,0 +1,117 @@
+#pragma once
+#ifndef KTUTILS_TRACE_P_HPP
+#define KTUTILS_TRACE_P_HPP
+
+#include <KtUtils/Trace.hpp>
+#include <KtUtils/WaitTrace.hpp>
+#include <deque>
+
+namespace KtUtils {
+namespace TraceExtra {
+// Span recorded by TraceScope.
+struct Span {
+  const char* name;
+  qint64 start;
+  qint64 duration;
+};
+
+// Ring buffer of spans of a thread.
+struct ThreadBuffer {
+  QMutex mutex;  // Only contended while exporting.
+  std::vector<Span> spans;  // Grows until capacity.
+  std::size_t capacity;
+  std::size_t next = 0;  // Oldest span once full.
+  quintptr thread = 0;
+  QString threadName;
+
+  explicit ThreadBuffer(std::size_t capacity) : capacity(capacity) {}
+
+  void push(const Span& span) {
+    QMutexLocker locker(&mutex);
+    if (spans.size() < capacity) {
+      spans.push_back(span);
+    } else if (!spans.empty()) {
+      spans[next] = span;
+      next = (next + 1) % spans.size();
+    }
+  }
+};
+
+// Span recorded by WaitScope.
+struct WaitSpan {
+  const char* kind;
+  WaitSite site;
+  quintptr thread;
+  qint64 start;
+  qint64 duration;
+  int depth;
+  quint64 events;
+  quint64 predicateCalls;
+};
+
+// State of Trace and WaitTrace, spans of both are measured by one clock so
+// that they line up in one trace.
+struct Registry {
+  QMutex mutex;
+  QElapsedTimer clock;
+
+  // Trace.
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  int bufferCapacity = 65536;
+
+  // WaitTrace.
+  QHash<QString, WaitSiteStatistics> waitSites;
+  std::deque<WaitSpan> waitSpans;
+  int waitCapacity = 10000;
+
+  Registry() { clock.start(); }
+
+  static Registry& instance();
+  // Nanoseconds since the registry is created.
+  qint64 now() const { return clock.nsecsElapsed(); }
+};
+
+// Builder of Chrome trace event format, which can be opened by
+// chrome://tracing or Perfetto.
+class ChromeTraceWriter {
+ public:
+  ChromeTraceWriter() : pid(double(QCoreApplication::applicationPid())) {}
+
+  // Metadata event naming a thread.
+  void addThread(quintptr thread, const QString& name) {
+    events << QJsonObject{
+        {QStringLiteral("name"), QStringLiteral("thread_name")},
+        {QStringLiteral("ph"), QStringLiteral("M")},
+        {QStringLiteral("pid"), pid},
+        {QStringLiteral("tid"), double(thread)},
+        {QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), name}}}};
+  }
+
+  // Complete event, start and duration in nanoseconds of Registry::now().
+  void addSpan(const QString& name, const QString& category, qint64 start,
+               qint64 duration, quintptr thread,
+               const QJsonObject& args = QJsonObject()) {
+    QJsonObject event{{QStringLiteral("name"), name},
+                      {QStringLiteral("cat"), category},
+                      {QStringLiteral("ph"), QStringLiteral("X")},
+                      {QStringLiteral("ts"), start / 1e3},
+                      {QStringLiteral("dur"), duration / 1e3},
+                      {QStringLiteral("pid"), pid},
+                      {QStringLiteral("tid"), double(thread)}};
+    if (!args.isEmpty()) event.insert(QStringLiteral("args"), args);
+    events << event;
+  }
+
+  // {"traceEvents": [...]}
+  QJsonObject toJson() const {
+    return QJsonObject{{QStringLiteral("traceEvents"), events}};
+  }
+
+ private:
+  double pid;
+  QJsonArray events;
+};
+}  // namespace TraceExtra
+}  // namespace KtUtils
+
+#endif  // KTUTILS_TRACE_P_HPP
@@ -0,0 +1,161 @@
+#include <KtUtils/WaitTrace>
+#include "EventHook_p.hpp"
+#include "Trace_p.hpp"
+#include "WaitTrace_p.hpp"
+
+namespace KtUtils {
+using TraceExtra::Registry;
+using TraceExtra::WaitSpan;
+
+namespace {
+std::atomic<bool> traceEnabled{false};
+
+// State of current thread.
+thread_local int threadDepth = 0;
+thread_local const WaitSite* threadSite = nullptr;
+thread_local quint64 threadEvents = 0;
+
+// Called by QCoreApplication before delivering each event.
+void CountEvent(const QObject*, const QEvent*) { ++threadEvents; }
+
+QString SiteName(const char* kind, const WaitSite& site) {
+  if (!site.file) return QString::fromLatin1(kind);
+  return QStringLiteral("%1:%2 %3")
+      .arg(QString::fromUtf8(site.file))
+      .arg(site.line)
+      .arg(QString::fromUtf8(site.function ? site.function : ""));
+}
+}  // namespace
+
+/* ======================== WaitSiteScope ======================== */
+WaitSiteScope::WaitSiteScope(const char* file, int line, const char* function)
+    : previous(threadSite) {
+  site.file = file;
+  site.line = line;
+  site.function = function;
+  threadSite = &site;
+}
+
+WaitSiteScope::~WaitSiteScope() { threadSite = previous; }
+/* ======================== WaitSiteScope ======================== */
+
+/* ======================== WaitScope ======================== */
+WaitScope::WaitScope(const char* kind)
+    : kind(kind), enabled(WaitTrace::isEnabled()) {
+  ++threadDepth;
+  if (enabled) {
+    start = Registry::instance().now();
+    events = threadEvents;
+  }
+}
+
+WaitScope::~WaitScope() {
+  const int depth = threadDepth--;
+  if (!enabled) return;
+
+  Registry& registry = Registry::instance();
+  WaitSpan span;
+  span.kind = kind;
+  span.site = threadSite ? *threadSite : WaitSite();
+  span.thread = quintptr(QThread::currentThreadId());
+  span.start = start;
+  span.duration = registry.now() - start;
+  span.depth = depth;
+  span.events = threadEvents - events;
+  span.predicateCalls = predicateCalls;
+  const QString name = SiteName(kind, span.site);
+
+  QMutexLocker locker(&registry.mutex);
+  WaitSiteStatistics& statistics = registry.waitSites[name];
+  statistics.site = name;
+  ++statistics.count;
+  statistics.events += span.events;
+  statistics.predicateCalls += span.predicateCalls;
+  statistics.totalTime += span.duration;
+  statistics.maxTime = qMax(statistics.maxTime, span.duration);
+  statistics.maxDepth = qMax(statistics.maxDepth, depth);
+  if (registry.waitCapacity > 0) {
+    while (int(registry.waitSpans.size()) >= registry.waitCapacity) {
+      registry.waitSpans.pop_front();
+    }
+    registry.waitSpans.push_back(span);
+  }
+}
+/* ======================== WaitScope ======================== */
+
+/* ======================== WaitTrace ======================== */
+void WaitTrace::setEnabled(bool enable) {
+  if (enable) EventHook::Add(&CountEvent);
+  traceEnabled.store(enable);
+}
+
+bool WaitTrace::isEnabled() {
+  return traceEnabled.load(std::memory_order_relaxed);
+}
+
+int WaitTrace::currentDepth() { return threadDepth; }
+
+QVector<WaitSiteStatistics> WaitTrace::statistics() {
+  Registry& registry = Registry::instance();
+  QVector<WaitSiteStatistics> ret;
+  {
+    QMutexLocker locker(&registry.mutex);
+    ret.reserve(registry.waitSites.size());
+    for (const WaitSiteStatistics& statistics : registry.waitSites) {
+      ret << statistics;
+    }
+  }
+  std::sort(ret.begin(), ret.end(),
+            [](const WaitSiteStatistics& a, const WaitSiteStatistics& b) {
+              return a.totalTime > b.totalTime;
+            });
+  return ret;
+}
+
+void WaitTrace::reset() {
+  Registry& registry = Registry::instance();
+  QMutexLocker locker(&registry.mutex);
+  registry.waitSites.clear();
+  registry.waitSpans.clear();
+}
+
+int WaitTrace::traceCapacity() {
+  Registry& registry = Registry::instance();
+  QMutexLocker locker(&registry.mutex);
+  return registry.waitCapacity;
+}
+
+void WaitTrace::setTraceCapacity(int capacity) {
+  Registry& registry = Registry::instance();
+  QMutexLocker locker(&registry.mutex);
+  registry.waitCapacity = qMax(capacity, 0);
+  while (int(registry.waitSpans.size()) > registry.waitCapacity) {
+    registry.waitSpans.pop_front();
+  }
+}
+
+QJsonObject WaitTrace::toChromeTrace() {
+  Registry& registry = Registry::instance();
+  TraceExtra::ChromeTraceWriter writer;
+  QMutexLocker locker(&registry.mutex);
+  for (const WaitSpan& span : registry.waitSpans) {
+    QJsonObject args{
+        {QStringLiteral("kind"), QString::fromLatin1(span.kind)},
+        {QStringLiteral("depth"), span.depth},
+        {QStringLiteral("events"), double(span.events)},
+        {QStringLiteral("predicateCalls"), double(span.predicateCalls)}};
+    if (span.site.file) {
+      args.insert(QStringLiteral("file"), QString::fromUtf8(span.site.file));
+      args.insert(QStringLiteral("line"), span.site.line);
+    }
+    const QString name =
+        (span.site.file && span.site.function)
+            ? QString::fromUtf8(span.site.function)
+            : QString::fromLatin1(span.kind);
+    writer.addSpan(name, QStringLiteral("wait"), span.start, span.duration,
+                   span.thread, args);
+  }
+  return writer.toJson();
+}
+/* ======================== WaitTrace ======================== */
+}  // namespace KtUtils
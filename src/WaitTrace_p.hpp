@@ -0,0 +1,27 @@
+#pragma once
+#ifndef KTUTILS_WAITTRACE_P_HPP
+#define KTUTILS_WAITTRACE_P_HPP
+
+#include <KtUtils/WaitTrace.hpp>
+
+namespace KtUtils {
+// Account a wait of current thread while alive, created by the function which
+// runs the nested event loop.
+class WaitScope {
+ public:
+  explicit WaitScope(const char* kind);
+  ~WaitScope();
+  WaitScope(const WaitScope&) = delete;
+  WaitScope& operator=(const WaitScope&) = delete;
+
+  quint64 predicateCalls = 0;
+
+ private:
+  const char* kind;
+  bool enabled;
+  qint64 start = 0;
+  quint64 events = 0;
+};
+}  // namespace KtUtils
+
+#endif  // KTUTILS_WAITTRACE_P_HPP
@@ -0,0 +1,146 @@
+﻿#include "BenchIcons.hpp"
+#include <QtConcurrent/QtConcurrent>
+#include <QtTest/QtTest>
+
+using namespace KtUtils;
+
+static constexpr IconHelper::Icon kIcon = IconHelper::Solid_gear;
+static constexpr ushort kGlyph = 0xf013;  // Gear in Font Awesome Solid font.
+
+// Resident memory of current process in bytes, 0 if not available.
+static qint64 ResidentMemory() {
+#ifdef Q_OS_LINUX
+  QFile file(QStringLiteral("/proc/self/status"));
+  if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    for (QByteArray line = file.readLine(); !line.isEmpty();
+         line = file.readLine()) {
+      if (line.startsWith("VmRSS:")) {
+        return line.mid(6).trimmed().split(' ').front().toLongLong() * 1024;
+      }
+    }
+  }
+#endif
+  return 0;
+}
+
+static void AddSizes() {
+  QTest::addColumn<int>("size");
+  for (int size : {16, 32, 64, 128, 256}) {
+    QTest::addRow("%d", size) << size;
+  }
+}
+
+void BenchIcons::initTestCase() {
+  // Load resources and fonts outside of measurements.
+  IconHelper::pixmap(kIcon, 16, Qt::white, false);
+  IconHelper::pixmap(IconHelper::Solid, QChar(kGlyph), 16, Qt::white,
+                     QFont::Normal, false);
+  IconHelper::resetStatistics();
+}
+
+void BenchIcons::svgCold_data() { AddSizes(); }
+
+void BenchIcons::svgCold() {
+  QFETCH(int, size);
+  QBENCHMARK { IconHelper::pixmap(kIcon, size, Qt::white, false); }
+}
+
+void BenchIcons::svgCached_data() { AddSizes(); }
+
+void BenchIcons::svgCached() {
+  QFETCH(int, size);
+  IconHelper::pixmap(kIcon, size, Qt::white);
+  QBENCHMARK { IconHelper::pixmap(kIcon, size, Qt::white); }
+}
+
+void BenchIcons::iconCold() {
+  QBENCHMARK { IconHelper::icon(kIcon, Qt::white, false); }
+}
+
+void BenchIcons::iconCached() {
+  IconHelper::icon(kIcon, Qt::white);
+  QBENCHMARK { IconHelper::icon(kIcon, Qt::white); }
+}
+
+void BenchIcons::fontCold_data() { AddSizes(); }
+
+void BenchIcons::fontCold() {
+  QFETCH(int, size);
+  QBENCHMARK {
+    IconHelper::pixmap(IconHelper::Solid, QChar(kGlyph), size, Qt::white,
+                       QFont::Normal, false);
+  }
+}
+
+void BenchIcons::fontCached_data() { AddSizes(); }
+
+void BenchIcons::fontCached() {
+  QFETCH(int, size);
+  IconHelper::pixmap(IconHelper::Solid, QChar(kGlyph), size, Qt::white);
+  QBENCHMARK {
+    IconHelper::pixmap(IconHelper::Solid, QChar(kGlyph), size, Qt::white);
+  }
+}
+
+void BenchIcons::cacheContention_data() {
+  QTest::addColumn<int>("threads");
+  for (int threads : {1, 2, 4, 8}) {
+    QTest::addRow("%d", threads) << threads;
+  }
+}
+
+void BenchIcons::cacheContention() {
+  QFETCH(int, threads);
+  static constexpr int kLookups = 1000;
+  static const QVector<int> kSizes = {16, 32, 48, 64};
+  for (int size : kSizes) {
+    IconHelper::pixmap(kIcon, size, Qt::white);
+  }
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads);
+  QBENCHMARK {
+    QVector<QFuture<void>> futures;
+    for (int i = 0; i < threads; ++i) {
+      futures << QtConcurrent::run(&pool, [] {
+        for (int j = 0; j < kLookups; ++j) {
+          IconHelper::pixmap(kIcon, kSizes.at(j % kSizes.size()), Qt::white);
+        }
+      });
+    }
+    for (auto& future : futures) {
+      future.waitForFinished();
+    }
+  }
+}
+
+void BenchIcons::memoryAllIcons() {
+  const QMetaEnum me = QMetaEnum::fromType<IconHelper::Icon>();
+  IconHelper::clearCache();
+  const qint64 before = ResidentMemory();
+  for (int i = 0; i < me.keyCount(); ++i) {
+    IconHelper::pixmap(IconHelper::Icon(me.value(i)), 32, Qt::white);
+  }
+  const qint64 after = ResidentMemory();
+
+  qint64 cached = 0;
+  for (const auto& cache : IconHelper::statistics(0).caches) {
+    cached += cache.bytes;
+  }
+  qInfo("Rendered %d icons, resident memory grows %lld bytes, caches hold "
+        "%lld bytes",
+        me.keyCount(), after - before, cached);
+  QTest::setBenchmarkResult((after > 0) ? (after - before) : cached,
+                            QTest::BytesAllocated);
+}
+
+void BenchIcons::cleanupTestCase() {
+  // Keep render statistics next to QtTest's own results.
+  QFile file(QStringLiteral("KtUtilsBenchIcons.statistics.json"));
+  if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    file.write(QJsonDocument(IconHelper::statistics().toJson())
+                   .toJson(QJsonDocument::Indented));
+  }
+}
+
+QTEST_MAIN(BenchIcons)
@@ -0,0 +1,33 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_BENCHICONS_HPP
+#define KTUTILS_TEST_BENCHICONS_HPP
+
+class BenchIcons : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void initTestCase();
+
+  void svgCold_data();
+  void svgCold();
+  void svgCached_data();
+  void svgCached();
+
+  void iconCold();
+  void iconCached();
+
+  void fontCold_data();
+  void fontCold();
+  void fontCached_data();
+  void fontCached();
+
+  void cacheContention_data();
+  void cacheContention();
+
+  void memoryAllIcons();
+
+  void cleanupTestCase();
+};
+
+#endif  // KTUTILS_TEST_BENCHICONS_HPP
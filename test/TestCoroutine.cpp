@@ -0,0 +1,88 @@
+﻿#include "TestCoroutine.hpp"
+#include <stdexcept>
+#include <QtConcurrent/QtConcurrent>
+#include <QtTest/QtTest>
+
+using namespace KtUtils;
+
+static Task<int> Delayed(int interval, int value) {
+  co_await KtUtils::delay(interval);
+  co_return value;
+}
+
+static Task<bool> Emitted(QObject* sender) {
+  co_return co_await KtUtils::signal(sender, &QObject::objectNameChanged);
+}
+
+static Task<int> Concurrent(int value) {
+  co_return co_await QtConcurrent::run([value] { return value * 2; });
+}
+
+static Task<int> Sum() {
+  const int a = co_await Delayed(10, 1);
+  const int b = co_await Concurrent(2);
+  co_return a + b;
+}
+
+static Task<> Throw(int interval) {
+  co_await KtUtils::delay(interval);
+  throw std::runtime_error("boom");
+}
+
+void TestCoroutine::delay() {
+  static constexpr int kInterval = 50;
+  QElapsedTimer timer;
+  timer.start();
+  Task<int> task = Delayed(kInterval, 42);
+  // Started immediately, suspended until the timer fires.
+  QVERIFY(!task.isFinished());
+  QTRY_VERIFY_WITH_TIMEOUT(task.isFinished(), 1000);
+  QVERIFY(timer.elapsed() >= (kInterval * 0.9));
+  QCOMPARE(task.result(), 42);
+}
+
+void TestCoroutine::signal() {
+  QObject sender;
+  Task<bool> task = Emitted(&sender);
+  QVERIFY(!task.isFinished());
+  sender.setObjectName(QStringLiteral("emitted"));
+  QTRY_VERIFY_WITH_TIMEOUT(task.isFinished(), 1000);
+  QCOMPARE(task.result(), true);
+}
+
+void TestCoroutine::signal_destroyed() {
+  auto sender = new QObject;
+  Task<bool> task = Emitted(sender);
+  delete sender;
+  QTRY_VERIFY_WITH_TIMEOUT(task.isFinished(), 1000);
+  QCOMPARE(task.result(), false);
+}
+
+void TestCoroutine::future() {
+  Task<int> task = Concurrent(21);
+  QTRY_VERIFY_WITH_TIMEOUT(task.isFinished(), 1000);
+  QCOMPARE(task.result(), 42);
+}
+
+void TestCoroutine::nested() {
+  Task<int> task = Sum();
+  QVERIFY(!task.isFinished());
+  QTRY_VERIFY_WITH_TIMEOUT(task.isFinished(), 1000);
+  QCOMPARE(task.result(), 5);
+}
+
+void TestCoroutine::exception() {
+  Task<> task = Throw(0);
+  QTRY_VERIFY_WITH_TIMEOUT(task.isFinished(), 1000);
+  QVERIFY_EXCEPTION_THROWN(task.result(), std::runtime_error);
+}
+
+void TestCoroutine::exception_discarded() {
+  // Logged when the frame finishes, as nobody takes the result.
+  QTest::ignoreMessage(QtWarningMsg,
+                       "KtUtils::Task: unhandled exception: boom");
+  Throw(10);
+  QTest::qWait(100);
+}
+
+QTEST_GUILESS_MAIN(TestCoroutine)
@@ -0,0 +1,19 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_COROUTINE_HPP
+#define KTUTILS_TEST_COROUTINE_HPP
+
+class TestCoroutine : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void delay();
+  void signal();
+  void signal_destroyed();
+  void future();
+  void nested();
+  void exception();
+  void exception_discarded();
+};
+
+#endif  // KTUTILS_TEST_COROUTINE_HPP
@@ -0,0 +1,164 @@
+﻿#include "TestDebounce.hpp"
+#include <QtTest/QtTest>
+
+using namespace std::literals::chrono_literals;
+using namespace KtUtils;
+
+void TestDebounce::debounce_trailing() {
+  QList<int> calls;
+  auto f = debounce<int>([&calls](int value) { calls << value; }, 50ms);
+  f(1);
+  f(2);
+  QTest::qWait(20);
+  f(3);
+  QVERIFY(calls.isEmpty());
+  // Window restarts on every call, only the last call is invoked.
+  QTest::qWait(30);
+  QVERIFY(calls.isEmpty());
+  QTRY_COMPARE(calls, QList<int>{3});
+  QTest::qWait(100);
+  QCOMPARE(calls, QList<int>{3});
+}
+
+void TestDebounce::debounce_leading() {
+  QList<int> calls;
+  auto f = debounce<int>([&calls](int value) { calls << value; }, 50,
+                         LeadingEdge);
+  f(1);
+  f(2);
+  f(3);
+  QCOMPARE(calls, QList<int>{1});
+  QTest::qWait(100);
+  QCOMPARE(calls, QList<int>{1});
+  // Next burst invokes at its first call again.
+  f(4);
+  QCOMPARE(calls, (QList<int>{1, 4}));
+
+  calls.clear();
+  QTest::qWait(100);
+  auto both = debounce<int>([&calls](int value) { calls << value; }, 50,
+                            LeadingEdge | TrailingEdge);
+  both(1);
+  both(2);
+  QCOMPARE(calls, QList<int>{1});
+  QTRY_COMPARE(calls, (QList<int>{1, 2}));
+}
+
+void TestDebounce::throttle_edges() {
+  QList<int> calls;
+  // Interval is longer than polling steps of QTRY_COMPARE.
+  auto f = throttle<int>([&calls](int value) { calls << value; }, 200);
+  f(1);
+  f(2);
+  f(3);
+  QCOMPARE(calls, QList<int>{1});
+  QTRY_COMPARE(calls, (QList<int>{1, 3}));
+  // Rate is kept after the trailing call.
+  f(4);
+  QCOMPARE(calls, (QList<int>{1, 3}));
+  QTRY_COMPARE(calls, (QList<int>{1, 3, 4}));
+}
+
+void TestDebounce::throttle_trailing() {
+  QList<int> calls;
+  QElapsedTimer timer;
+  timer.start();
+  auto f = throttle<int>([&calls](int value) { calls << value; }, 20ms,
+                         TrailingEdge);
+  // Steady calls are invoked once per interval, not postponed.
+  while (timer.elapsed() < 200) {
+    f(int(timer.elapsed()));
+    QTest::qWait(5);
+  }
+  QVERIFY(calls.size() >= 4);
+  QVERIFY(calls.size() <= 11);
+}
+
+void TestDebounce::debounce_threadExited() {
+  QList<int> calls;
+  std::function<void(int)> f =
+      debounce<int>([&calls](int value) { calls << value; }, 50);
+  // Window opened in a thread which exits before it expires.
+  QThread* thread = QThread::create([&f] { f(1); });
+  thread->start();
+  QVERIFY(thread->wait(1000));
+  delete thread;
+
+  // Dropped with the thread's wheel, calls schedule in this thread.
+  f(2);
+  QTRY_COMPARE(calls, QList<int>{2});
+}
+
+// Calls recorded with thread they are invoked in.
+struct ThreadCalls {
+  QMutex mutex;
+  QList<QPair<int, QThread*>> calls;
+
+  void add(int value) {
+    QMutexLocker locker(&mutex);
+    calls << qMakePair(value, QThread::currentThread());
+  }
+  QList<QPair<int, QThread*>> get() {
+    QMutexLocker locker(&mutex);
+    return calls;
+  }
+};
+
+void TestDebounce::debounce_twoThreads() {
+  QThread thread;
+  QObject context;
+  context.moveToThread(&thread);
+  thread.start();
+
+  ThreadCalls calls;
+  std::function<void(int)> f =
+      debounce<int>([&calls](int value) { calls.add(value); }, 50);
+  // Window opened by a live thread is dropped by a call in this thread.
+  QMetaObject::invokeMethod(&context, [&f] { f(1); },
+                            Qt::BlockingQueuedConnection);
+  f(2);
+  QTRY_COMPARE(calls.get().size(), 1);
+  QTest::qWait(100);
+  QCOMPARE(calls.get().size(), 1);
+  QCOMPARE(calls.get().first(), qMakePair(2, QThread::currentThread()));
+
+  // And the other way around, trailing call is invoked in the other thread.
+  f(3);
+  QMetaObject::invokeMethod(&context, [&f] { f(4); },
+                            Qt::BlockingQueuedConnection);
+  QTRY_COMPARE(calls.get().size(), 2);
+  QTest::qWait(100);
+  QCOMPARE(calls.get().last(), qMakePair(4, &thread));
+
+  thread.quit();
+  QVERIFY(thread.wait(1000));
+}
+
+void TestDebounce::throttle_twoThreads() {
+  QThread thread;
+  QObject context;
+  context.moveToThread(&thread);
+  thread.start();
+
+  ThreadCalls calls;
+  std::function<void(int)> f =
+      throttle<int>([&calls](int value) { calls.add(value); }, 50);
+  QList<QThread*> threads{&thread, QThread::currentThread()};
+  // Calls from both threads at the same time, invoked in either of them.
+  std::atomic<bool> done{false};
+  QMetaObject::invokeMethod(&context, [&f, &done] {
+    for (int i = 0; i < 1000; ++i) f(i);
+    done = true;
+  });
+  for (int i = 0; i < 1000; ++i) f(i);
+  QTRY_VERIFY(done);
+  QTest::qWait(100);
+  const QList<QPair<int, QThread*>> result = calls.get();
+  QVERIFY(!result.isEmpty());
+  for (const auto& call : result) QVERIFY(threads.contains(call.second));
+
+  thread.quit();
+  QVERIFY(thread.wait(1000));
+}
+
+QTEST_GUILESS_MAIN(TestDebounce)
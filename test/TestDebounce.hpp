@@ -0,0 +1,19 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_DEBOUNCE_HPP
+#define KTUTILS_TEST_DEBOUNCE_HPP
+
+class TestDebounce : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void debounce_trailing();
+  void debounce_leading();
+  void throttle_edges();
+  void throttle_trailing();
+  void debounce_threadExited();
+  void debounce_twoThreads();
+  void throttle_twoThreads();
+};
+
+#endif  // KTUTILS_TEST_DEBOUNCE_HPP
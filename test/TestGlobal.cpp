@@ -233,4 +233,425 @@ void TestGlobal::WaitUntil_std_invalid() {
   future.waitForFinished();
 }
 
+void TestGlobal::WaitForSignal() {
+  static constexpr int kTimeout = 100;
+  QTimer sender;
+  sender.setSingleShot(true);
+  sender.start(kTimeout / 2);
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(::WaitForSignal(&sender, &QTimer::timeout, kTimeout));
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9 / 2));
+  QVERIFY(timer.elapsed() < kTimeout);
+}
+
+void TestGlobal::WaitForSignal_timeout() {
+  static constexpr int kTimeout = 100;
+  QTimer sender;
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(!::WaitForSignal(&sender, &QTimer::timeout, kTimeout));
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9));
+  QVERIFY(timer.elapsed() < (kTimeout + 100));
+}
+
+void TestGlobal::WaitForSignal_std() {
+  static constexpr auto kDuration = 100ms;
+  QTimer sender;
+  sender.setSingleShot(true);
+  sender.start(kDuration / 2);
+  auto now = steady_clock::now();
+  QVERIFY(::WaitForSignal(&sender, &QTimer::timeout, kDuration));
+  duration<double, std::milli> elapsed = steady_clock::now() - now;
+  QVERIFY(elapsed >= (kDuration * 0.9 / 2));
+  QVERIFY(elapsed < kDuration);
+}
+
+void TestGlobal::WaitCondition_notify() {
+  static constexpr int kTimeout = 100;
+  KtUtils::WaitCondition condition;
+  auto future = QtConcurrent::run([&condition] {
+    QThread::msleep(kTimeout / 2);
+    condition.notify();
+  });
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(::WaitFor(kTimeout, QEventLoop::AllEvents, condition));
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9 / 2));
+  QVERIFY(timer.elapsed() < kTimeout);
+  future.waitForFinished();
+}
+
+void TestGlobal::WaitCondition_notified() {
+  static constexpr auto kDuration = 100ms;
+  KtUtils::WaitCondition condition;
+  condition.notify();
+  auto now = steady_clock::now();
+  QVERIFY(::WaitFor(kDuration, QEventLoop::AllEvents, condition));
+  QVERIFY((steady_clock::now() - now) < (kDuration / 2));
+
+  condition.reset();
+  QVERIFY(!condition.isNotified());
+  QVERIFY(!::WaitFor(0, QEventLoop::AllEvents, condition));
+}
+
+void TestGlobal::WaitCondition_timeout() {
+  static constexpr int kTimeout = 100;
+  KtUtils::WaitCondition condition;
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(!::WaitFor(kTimeout, QEventLoop::AllEvents, condition));
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9));
+  QVERIFY(timer.elapsed() < (kTimeout + 100));
+}
+
+void TestGlobal::WaitFor_backoff() {
+  static constexpr int kTimeout = 100;
+  QElapsedTimer validTimer;
+  validTimer.start();
+  auto valid = [&validTimer] { return validTimer.elapsed() >= (kTimeout / 2); };
+  WaitStatistics statistics;
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(::WaitFor(kTimeout, QEventLoop::AllEvents, valid,
+                    WaitBackoff{1, 2, 10}, &statistics));
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9 / 2));
+  QVERIFY(timer.elapsed() < kTimeout);
+  // 1 + 2 + 4 + 8 + 10 * n milliseconds, far less than spinning.
+  QVERIFY(statistics.predicateCalls >= 2);
+  QVERIFY(statistics.predicateCalls < 20);
+  QVERIFY(statistics.elapsedTime >= (kTimeout * 0.9 / 2 * 1e6));
+  QVERIFY(statistics.cpuTime <= statistics.elapsedTime);
+}
+
+void TestGlobal::WaitFor_backoff_invalid() {
+  static constexpr auto kDuration = 100ms;
+  auto invalid = [] { return false; };
+  WaitStatistics statistics;
+  auto now = steady_clock::now();
+  QVERIFY(!::WaitFor(kDuration, QEventLoop::AllEvents, invalid,
+                     WaitBackoff{1, 2, 20}, &statistics));
+  duration<double, std::milli> elapsed = steady_clock::now() - now;
+  QVERIFY(elapsed >= (kDuration * 0.9));
+  QVERIFY(elapsed <= (kDuration + 100ms));
+  QVERIFY(statistics.predicateCalls < 20);
+}
+
+void TestGlobal::WaitFor_backoff_clamped() {
+  static constexpr auto kDuration = 100ms;
+  auto invalid = [] { return false; };
+  // Zero interval and shrinking growth are clamped to 1ms, no spinning.
+  for (const WaitBackoff& backoff :
+       {WaitBackoff{0, 2, 20}, WaitBackoff{1, 0.5, 20}, WaitBackoff{1, 2, 0},
+        WaitBackoff{-1, 0, -1}}) {
+    WaitStatistics statistics;
+    auto now = steady_clock::now();
+    QVERIFY(!::WaitFor(kDuration, QEventLoop::AllEvents, invalid, backoff,
+                       &statistics));
+    duration<double, std::milli> elapsed = steady_clock::now() - now;
+    QVERIFY(elapsed >= (kDuration * 0.9));
+    QVERIFY(elapsed <= (kDuration + 100ms));
+    QVERIFY(statistics.predicateCalls <= 110);
+  }
+}
+
+void TestGlobal::WaitAny() {
+  static constexpr int kTimeout = 100;
+  auto slow = QtConcurrent::run([] { QThread::msleep(kTimeout * 2); });
+  auto fast = QtConcurrent::run([] {
+    QThread::msleep(kTimeout / 2);
+    return 1;
+  });
+  QTimer sender;
+  QElapsedTimer timer;
+  timer.start();
+  QCOMPARE(::WaitAny(kTimeout, QEventLoop::AllEvents, slow, fast,
+                     std::make_pair(&sender, &QTimer::timeout)),
+           1);
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9 / 2));
+  QVERIFY(timer.elapsed() < kTimeout);
+  slow.waitForFinished();
+}
+
+void TestGlobal::WaitAny_timeout() {
+  static constexpr auto kDuration = 100ms;
+  QTimer sender;
+  auto now = steady_clock::now();
+  QCOMPARE(::WaitAny(kDuration, QEventLoop::AllEvents,
+                     std::make_pair(&sender, &QTimer::timeout)),
+           -1);
+  duration<double, std::milli> elapsed = steady_clock::now() - now;
+  QVERIFY(elapsed >= (kDuration * 0.9));
+  QVERIFY(elapsed <= (kDuration + 100ms));
+}
+
+void TestGlobal::WaitAll() {
+  static constexpr int kTimeout = 100;
+  auto future = QtConcurrent::run([] { QThread::msleep(kTimeout / 4); });
+  QFutureWatcher<void> watcher;
+  watcher.setFuture(
+      QtConcurrent::run([] { QThread::msleep(kTimeout / 4); }));
+  QTimer sender;
+  sender.setSingleShot(true);
+  sender.start(kTimeout / 2);
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(::WaitAll(kTimeout, QEventLoop::AllEvents, future, &watcher,
+                    std::make_pair(&sender, &QTimer::timeout)));
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9 / 2));
+  QVERIFY(timer.elapsed() < kTimeout);
+  QVERIFY(future.isFinished());
+  QVERIFY(watcher.isFinished());
+}
+
+void TestGlobal::WaitUntil_deadline() {
+  static constexpr int kTimeout = 100;
+  QElapsedTimer timer;
+  timer.start();
+  ::WaitUntil(QDeadlineTimer(kTimeout, Qt::PreciseTimer));
+  QVERIFY(timer.elapsed() >= kTimeout);
+  QVERIFY(timer.elapsed() < (kTimeout + 100));
+  QCOMPARE(TimerWheel::instance()->pendingCount(), 0);
+}
+
+void TestGlobal::WaitUntil_deadline_condition() {
+  static constexpr int kTimeout = 100;
+  KtUtils::WaitCondition condition;
+  auto future = QtConcurrent::run([&condition] {
+    QThread::msleep(kTimeout / 2);
+    condition.notify();
+  });
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(::WaitUntil(QDeadlineTimer(kTimeout, Qt::PreciseTimer),
+                      QEventLoop::AllEvents, condition));
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9 / 2));
+  QVERIFY(timer.elapsed() < kTimeout);
+  QCOMPARE(TimerWheel::instance()->pendingCount(), 0);
+  future.waitForFinished();
+
+  condition.reset();
+  timer.restart();
+  QVERIFY(!::WaitUntil(QDeadlineTimer(kTimeout, Qt::PreciseTimer),
+                       QEventLoop::AllEvents, condition));
+  QVERIFY(timer.elapsed() >= kTimeout);
+}
+
+void TestGlobal::WaitCondition_thread() {
+  static constexpr int kTimeout = 100;
+  KtUtils::WaitCondition condition;
+  QElapsedTimer timer;
+  timer.start();
+  // Pool thread has no event loop, sleeps in its event dispatcher.
+  auto future = QtConcurrent::run([&condition] {
+    return ::WaitFor(kTimeout * 2, QEventLoop::AllEvents, condition);
+  });
+  QThread::msleep(kTimeout / 2);
+  condition.notify();
+  QVERIFY(future.result());
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9 / 2));
+  QVERIFY(timer.elapsed() < kTimeout);
+}
+
+void TestGlobal::WaitForSignal_pool() {
+  // Pool thread never runs exec(), but delivers events of its objects while
+  // waiting.
+  auto future = QtConcurrent::run([] {
+    QTimer timer;
+    timer.setSingleShot(true);
+    timer.start(10);
+    if (!::WaitForSignal(&timer, &QTimer::timeout, 1000)) return false;
+
+    QProcess process;
+    process.start(QCoreApplication::applicationFilePath(),
+                  {QStringLiteral("-functions")});
+    return ::WaitForSignal(
+        &process,
+        QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+        10000);
+  });
+  QVERIFY(future.result());
+}
+
+void TestGlobal::WaitFor_thread() {
+  static constexpr int kTimeout = 100;
+  std::atomic<bool> valid{false};
+  QElapsedTimer timer;
+  timer.start();
+  // Pool thread has no event loop, sleeps between checks.
+  auto future = QtConcurrent::run([&valid] {
+    return ::WaitFor(kTimeout * 2, QEventLoop::AllEvents,
+                     [&valid] { return valid.load(); });
+  });
+  QThread::msleep(kTimeout / 2);
+  valid = true;
+  QVERIFY(future.result());
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9 / 2));
+  QVERIFY(timer.elapsed() < kTimeout);
+
+  timer.restart();
+  future = QtConcurrent::run([] {
+    return ::WaitFor(kTimeout, QEventLoop::AllEvents, [] { return false; });
+  });
+  QVERIFY(!future.result());
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9));
+  QVERIFY(timer.elapsed() < (kTimeout + 100));
+}
+
+void TestGlobal::WaitFor_queue() {
+  static constexpr int kTimeout = 100;
+  static constexpr int kTaskCount = 10;
+  TaskQueue queue;  // No pool, only run by the waiting thread.
+  std::atomic<int> finished{0};
+  for (int i = 0; i < kTaskCount; ++i) {
+    queue.post(
+        [&finished] {
+          QThread::msleep(1);
+          ++finished;
+        },
+        1);
+  }
+  QVERIFY(::WaitFor(kTimeout, QEventLoop::AllEvents,
+                    [&finished] { return finished == kTaskCount; }, queue));
+  QCOMPARE(queue.pendingCount(), 0);
+}
+
+void TestGlobal::WaitFor_queue_overrun() {
+  static constexpr int kTimeout = 100;
+  static constexpr int kTaskTime = 10;
+  TaskQueue queue;
+  int finished = 0;
+  // Too long for the bound, never taken.
+  queue.post([&finished] { ++finished; }, kTaskTime * 2);
+  // Overruns its estimate, no more task is taken after it.
+  queue.post(
+      [&finished] {
+        QThread::msleep(kTaskTime * 2);
+        ++finished;
+      },
+      1);
+  queue.post([&finished] { ++finished; }, 1);
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(!::WaitFor(kTimeout, QEventLoop::AllEvents,
+                     [&finished] { return finished == 3; }, queue,
+                     kTaskTime));
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9));
+  QVERIFY(timer.elapsed() < (kTimeout + 100));
+  QCOMPARE(finished, 1);
+  QCOMPARE(queue.pendingCount(), 2);
+}
+
+void TestGlobal::WaitFor_queue_unestimated() {
+  static constexpr int kTimeout = 20;
+  TaskQueue queue;
+  bool executed = false;
+  // Run time is unknown, never taken by a wait with a deadline.
+  queue.post([&executed] { executed = true; });
+  QVERIFY(!::WaitFor(kTimeout, QEventLoop::AllEvents, [] { return false; },
+                     queue, std::numeric_limits<double>::infinity()));
+  QVERIFY(!executed);
+  QCOMPARE(queue.pendingCount(), 1);
+  QVERIFY(!queue.runOne(1000));
+  QVERIFY(queue.runOne());
+  QVERIFY(executed);
+
+  // Same for tasks of Executor::run(), which has no estimate.
+  Executor executor(1);
+  QSemaphore started;
+  QSemaphore release;
+  executor.post([&started, &release] {
+    started.release();
+    release.acquire();
+  });
+  // Worker is busy, the task stays queued.
+  started.acquire();
+  auto future = executor.run([] {});
+  QVERIFY(!::WaitFor(kTimeout, QEventLoop::AllEvents, [] { return false; },
+                     executor));
+  QVERIFY(!future.isFinished());
+  release.release();
+  future.waitForFinished();
+}
+
+void TestGlobal::WaitFor_cancellation() {
+  static constexpr int kTimeout = 100;
+  Executor executor(2);
+  CancellationToken token;
+  auto canceler = executor.run([token]() mutable {
+    QThread::msleep(kTimeout / 2);
+    token.cancel();
+  });
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(::WaitFor(kTimeout, QEventLoop::AllEvents, token.condition()));
+  QVERIFY(timer.elapsed() >= (kTimeout * 0.9 / 2));
+  QVERIFY(timer.elapsed() < kTimeout);
+  canceler.waitForFinished();
+
+  // Canceled before start, the task is skipped.
+  bool executed = false;
+  auto skipped = executor.run(token, [&executed] { executed = true; });
+  skipped.waitForFinished();
+  QVERIFY(skipped.isCanceled());
+  QVERIFY(!executed);
+}
+
+void TestGlobal::WaitFor_executor() {
+  static constexpr int kTimeout = 1000;
+  static constexpr int kTaskCount = 1000;
+  Executor executor(4);
+  std::atomic<int> sum{0};
+  for (int i = 0; i < kTaskCount; ++i) {
+    executor.post([&sum, i] { sum += i; });
+  }
+  // Continuation runs in the thread of context.
+  QObject context;
+  auto future = executor.run([] { return QThread::currentThread(); });
+  auto continuation = then(future, &context, [](QThread* thread) {
+    return (thread != QThread::currentThread()) &&
+           (QThread::currentThread() == qApp->thread());
+  });
+  QVERIFY(::WaitFor(kTimeout, QEventLoop::AllEvents,
+                    [&sum, &continuation] {
+                      return (sum == (kTaskCount * (kTaskCount - 1) / 2)) &&
+                             continuation.isFinished();
+                    },
+                    executor));
+  QVERIFY(continuation.result());
+}
+
+void TestGlobal::WaitTrace_nested() {
+  WaitTrace::setEnabled(true);
+  WaitTrace::reset();
+  int innerDepth = 0;
+  QTimer::singleShot(0, [&innerDepth] {
+    KTUTILS_WAIT_SITE();
+    ::WaitFor(10, QEventLoop::AllEvents, [&innerDepth] {
+      innerDepth = WaitTrace::currentDepth();
+      return false;
+    });
+  });
+  {
+    KTUTILS_WAIT_SITE();
+    ::WaitFor(100);
+  }
+  WaitTrace::setEnabled(false);
+
+  QCOMPARE(WaitTrace::currentDepth(), 0);
+  QCOMPARE(innerDepth, 2);
+  const QVector<WaitSiteStatistics> statistics = WaitTrace::statistics();
+  QCOMPARE(statistics.size(), 2);
+  // Sorted by total time, outer wait first.
+  QCOMPARE(statistics[0].maxDepth, 1);
+  QVERIFY(statistics[0].events > 0);
+  QCOMPARE(statistics[1].maxDepth, 2);
+  QVERIFY(statistics[1].predicateCalls > 0);
+  QCOMPARE(WaitTrace::toChromeTrace()
+               .value(QStringLiteral("traceEvents"))
+               .toArray()
+               .size(),
+           2);
+}
+
 QTEST_GUILESS_MAIN(TestGlobal)
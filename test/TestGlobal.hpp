@@ -24,6 +24,38 @@ class TestGlobal : public QObject
   void WaitUntil_std();
   void WaitUntil_std_valid();
   void WaitUntil_std_invalid();
+
+  void WaitForSignal();
+  void WaitForSignal_timeout();
+  void WaitForSignal_std();
+
+  void WaitCondition_notify();
+  void WaitCondition_notified();
+  void WaitCondition_timeout();
+
+  void WaitFor_backoff();
+  void WaitFor_backoff_invalid();
+  void WaitFor_backoff_clamped();
+
+  void WaitAny();
+  void WaitAny_timeout();
+  void WaitAll();
+
+  void WaitUntil_deadline();
+  void WaitUntil_deadline_condition();
+
+  void WaitCondition_thread();
+  void WaitForSignal_pool();
+  void WaitFor_thread();
+
+  void WaitFor_queue();
+  void WaitFor_queue_overrun();
+  void WaitFor_queue_unestimated();
+
+  void WaitFor_cancellation();
+  void WaitFor_executor();
+
+  void WaitTrace_nested();
 };
 
 #endif  // KTUTILS_TEST_GLOBAL_HPP
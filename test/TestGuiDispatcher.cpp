@@ -0,0 +1,96 @@
+﻿#include "TestGuiDispatcher.hpp"
+#include <QtConcurrent/QtConcurrent>
+#include <QtTest/QtTest>
+
+using namespace KtUtils;
+
+// Count drain events delivered to the dispatcher, one per batch.
+class BatchCounter : public QObject {
+ public:
+  int batches = 0;
+
+ protected:
+  bool eventFilter(QObject*, QEvent* event) override {
+    if (event->type() >= QEvent::User) ++batches;
+    return false;
+  }
+};
+
+void TestGuiDispatcher::post_order() {
+  static constexpr int kProducers = 4;
+  static constexpr int kCount = 10000;
+  GuiDispatcher dispatcher;
+  std::vector<int> last(kProducers, -1);
+  bool ordered = true;
+  int received = 0;
+
+  QList<QFuture<void>> producers;
+  for (int producer = 0; producer < kProducers; ++producer) {
+    producers << QtConcurrent::run([&, producer] {
+      for (int i = 0; i < kCount; ++i) {
+        dispatcher.post([&, producer, i] {
+          // Functions of each producer run in posted order.
+          if (last[producer] != i - 1) ordered = false;
+          last[producer] = i;
+          ++received;
+        });
+      }
+    });
+  }
+  for (QFuture<void>& producer : producers) producer.waitForFinished();
+  QTRY_COMPARE_WITH_TIMEOUT(received, kProducers * kCount, 10000);
+  QVERIFY(ordered);
+}
+
+void TestGuiDispatcher::post_keyed() {
+  GuiDispatcher dispatcher;
+  QStringList runs;
+  dispatcher.post(1, [&runs] { runs << QStringLiteral("1a"); });
+  dispatcher.post([&runs] { runs << QStringLiteral("x"); });
+  dispatcher.post(2, [&runs] { runs << QStringLiteral("2a"); });
+  dispatcher.post(1, [&runs] { runs << QStringLiteral("1b"); });
+  QCoreApplication::sendPostedEvents(&dispatcher);
+  // Latest function of a key runs at the position it's posted.
+  QCOMPARE(runs, (QStringList{QStringLiteral("x"), QStringLiteral("2a"),
+                              QStringLiteral("1b")}));
+
+  // Keys are coalesced only within a batch.
+  dispatcher.post(1, [&runs] { runs << QStringLiteral("1c"); });
+  QCoreApplication::sendPostedEvents(&dispatcher);
+  QCOMPARE(runs.last(), QStringLiteral("1c"));
+}
+
+void TestGuiDispatcher::post_coalesced() {
+  GuiDispatcher dispatcher;
+  BatchCounter counter;
+  dispatcher.installEventFilter(&counter);
+  int runs = 0;
+  for (int i = 0; i < 100; ++i) dispatcher.post([&runs] { ++runs; });
+  // Only the first post schedules an event.
+  QCoreApplication::sendPostedEvents(&dispatcher);
+  QCOMPARE(runs, 100);
+  QCOMPARE(counter.batches, 1);
+
+  // Flag is cleared by the batch, next post schedules again.
+  dispatcher.post([&runs] { ++runs; });
+  QCoreApplication::sendPostedEvents(&dispatcher);
+  QCOMPARE(runs, 101);
+  QCOMPARE(counter.batches, 2);
+}
+
+void TestGuiDispatcher::post_reentrant() {
+  GuiDispatcher dispatcher;
+  BatchCounter counter;
+  dispatcher.installEventFilter(&counter);
+  QList<int> batches;
+  std::function<void(void)> repost = [&] {
+    batches << counter.batches;
+    if (batches.size() < 3) dispatcher.post(repost);
+  };
+  dispatcher.post(repost);
+  // Functions posted by a running batch run in next batches.
+  QTRY_COMPARE(batches.size(), 3);
+  QCOMPARE(batches, (QList<int>{1, 2, 3}));
+}
+
+QTEST_GUILESS_MAIN(TestGuiDispatcher)
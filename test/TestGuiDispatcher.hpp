@@ -0,0 +1,16 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_GUIDISPATCHER_HPP
+#define KTUTILS_TEST_GUIDISPATCHER_HPP
+
+class TestGuiDispatcher : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void post_order();
+  void post_keyed();
+  void post_coalesced();
+  void post_reentrant();
+};
+
+#endif  // KTUTILS_TEST_GUIDISPATCHER_HPP
@@ -0,0 +1,121 @@
+﻿#include "TestHistogram.hpp"
+#include <QtTest/QtTest>
+
+using namespace KtUtils;
+
+void TestHistogram::bucket_small() {
+  // Values below sub-bucket count have their own bucket.
+  for (int value = 0; value < Histogram::kSubBucketCount; ++value) {
+    QCOMPARE(Histogram::bucketIndex(value), value);
+    QCOMPARE(Histogram::bucketLowerBound(value), qint64(value));
+  }
+  QCOMPARE(Histogram::bucketIndex(-5), 0);
+}
+
+void TestHistogram::bucket_boundary() {
+  // [16, 32) is still exact, [32, 64) has buckets of width 2, and so on.
+  QCOMPARE(Histogram::bucketIndex(16), 16);
+  QCOMPARE(Histogram::bucketIndex(31), 31);
+  QCOMPARE(Histogram::bucketIndex(32), 32);
+  QCOMPARE(Histogram::bucketIndex(33), 32);
+  QCOMPARE(Histogram::bucketIndex(34), 33);
+  QCOMPARE(Histogram::bucketLowerBound(33), qint64(34));
+  QCOMPARE(Histogram::bucketIndex(1000), 111);
+  QCOMPARE(Histogram::bucketLowerBound(111), qint64(992));
+  QCOMPARE(Histogram::bucketIndex(1024), 112);
+  QCOMPARE(Histogram::bucketLowerBound(112), qint64(1024));
+
+  const qint64 largest = std::numeric_limits<qint64>::max();
+  QCOMPARE(Histogram::bucketIndex(largest), Histogram::kBucketCount - 1);
+  QCOMPARE(Histogram::bucketLowerBound(Histogram::kBucketCount - 1),
+           qint64(31) << 58);
+}
+
+void TestHistogram::bucket_roundTrip() {
+  for (int i = 0; i < Histogram::kBucketCount - 1; ++i) {
+    const qint64 lower = Histogram::bucketLowerBound(i);
+    const qint64 upper = Histogram::bucketLowerBound(i + 1) - 1;
+    QVERIFY(lower <= upper);
+    QCOMPARE(Histogram::bucketIndex(lower), i);
+    QCOMPARE(Histogram::bucketIndex(upper), i);
+    // Relative error of a bucket is less than 1 / kSubBucketCount.
+    QVERIFY((upper - lower) * Histogram::kSubBucketCount <= upper);
+  }
+}
+
+void TestHistogram::record_summary() {
+  Histogram histogram;
+  for (int value = 1; value <= 100; ++value) {
+    histogram.record(value);
+  }
+  QCOMPARE(histogram.count(), quint64(100));
+  QCOMPARE(histogram.min(), qint64(1));
+  QCOMPARE(histogram.max(), qint64(100));
+  QCOMPARE(histogram.mean(), 50.5);
+  QCOMPARE(histogram.percentile(0), qint64(1));
+  QCOMPARE(histogram.percentile(50), qint64(50));
+  QCOMPARE(histogram.percentile(99.9), qint64(100));
+  QCOMPARE(histogram.percentile(100), qint64(100));
+  // Bucket [96, 100) holds the 97th value.
+  QCOMPARE(histogram.percentile(97), qint64(96));
+
+  // Negative values are recorded as 0.
+  histogram.record(-10);
+  QCOMPARE(histogram.count(), quint64(101));
+  QCOMPARE(histogram.min(), qint64(0));
+  QCOMPARE(histogram.mean(), 5050.0 / 101);
+}
+
+void TestHistogram::record_empty() {
+  Histogram histogram;
+  QCOMPARE(histogram.count(), quint64(0));
+  QCOMPARE(histogram.min(), qint64(0));
+  QCOMPARE(histogram.max(), qint64(0));
+  QCOMPARE(histogram.mean(), 0.0);
+  QCOMPARE(histogram.percentile(50), qint64(0));
+
+  histogram.record(7);
+  histogram.reset();
+  QCOMPARE(histogram.count(), quint64(0));
+  QCOMPARE(histogram.min(), qint64(0));
+}
+
+void TestHistogram::merge_copy() {
+  Histogram first;
+  first.record(10);
+  first.record(20);
+  Histogram second;
+  second.record(5);
+  second.record(1000);
+
+  Histogram merged(first);
+  merged.merge(second);
+  QCOMPARE(merged.count(), quint64(4));
+  QCOMPARE(merged.min(), qint64(5));
+  QCOMPARE(merged.max(), qint64(1000));
+  QCOMPARE(merged.mean(), 1035.0 / 4);
+  QCOMPARE(merged.percentile(75), qint64(20));
+  QCOMPARE(first.count(), quint64(2));
+
+  merged = second;
+  QCOMPARE(merged.count(), quint64(2));
+  QCOMPARE(merged.min(), qint64(5));
+  QCOMPARE(merged.max(), qint64(1000));
+}
+
+void TestHistogram::toJson() {
+  Histogram histogram;
+  histogram.record(3);
+  histogram.record(3);
+  histogram.record(1000);
+  const QJsonObject json = histogram.toJson();
+  QCOMPARE(json.value(QStringLiteral("count")).toInt(), 3);
+  QCOMPARE(json.value(QStringLiteral("min")).toInt(), 3);
+  QCOMPARE(json.value(QStringLiteral("max")).toInt(), 1000);
+  QCOMPARE(json.value(QStringLiteral("p50")).toInt(), 3);
+  QCOMPARE(json.value(QStringLiteral("p99")).toInt(), 992);
+  const QJsonArray buckets = json.value(QStringLiteral("buckets")).toArray();
+  QCOMPARE(buckets, (QJsonArray{QJsonArray{3, 2}, QJsonArray{992, 1}}));
+}
+
+QTEST_GUILESS_MAIN(TestHistogram)
@@ -0,0 +1,19 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_HISTOGRAM_HPP
+#define KTUTILS_TEST_HISTOGRAM_HPP
+
+class TestHistogram : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void bucket_small();
+  void bucket_boundary();
+  void bucket_roundTrip();
+  void record_summary();
+  void record_empty();
+  void merge_copy();
+  void toJson();
+};
+
+#endif  // KTUTILS_TEST_HISTOGRAM_HPP
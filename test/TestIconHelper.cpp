@@ -0,0 +1,413 @@
+﻿#include "TestIconHelper.hpp"
+#include <QtTest/QtTest>
+#include "IconHelper_p.hpp"
+
+using namespace KtUtils;
+
+// Counters of the cache with given name.
+static IconHelper::CacheStatistics CacheOf(const QString& name) {
+  for (const auto& cache : IconHelper::statistics(0).caches) {
+    if (cache.name == name) return cache;
+  }
+  return IconHelper::CacheStatistics();
+}
+
+static qint64 Bytes(const QPixmap& pixmap) {
+  return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+static QPixmap House(bool cached = true) {
+  return IconHelper::pixmap(IconHelper::Solid_house, 16, Qt::red, cached);
+}
+
+static QPixmap Star() {
+  return IconHelper::pixmap(IconHelper::Solid_star, 16, Qt::red);
+}
+
+// Timer of the shared animation clock, nullptr before the first animation.
+static QTimer* AnimationTimer() {
+  const QObject* clock = QCoreApplication::instance()->findChild<QObject*>(
+      QStringLiteral("KtUtils::AnimationClock"), Qt::FindDirectChildrenOnly);
+  return clock ? clock->findChild<QTimer*>() : nullptr;
+}
+
+void TestIconHelper::init() {
+  IconHelper::setCacheLimit(0);
+  IconHelper::clearCache();
+  IconHelper::resetStatistics();
+}
+
+void TestIconHelper::cache_hitMiss() {
+  const QPixmap first = House();
+  IconHelper::CacheStatistics cache = CacheOf(QStringLiteral("pixmap"));
+  QCOMPARE(cache.name, QStringLiteral("pixmap"));
+  QCOMPARE(cache.hits, quint64(0));
+  QCOMPARE(cache.misses, quint64(1));
+  QCOMPARE(cache.evictions, quint64(0));
+  QCOMPARE(cache.entries, 1);
+  QCOMPARE(cache.bytes, Bytes(first));
+  QCOMPARE(first.size(), QSize(16, 16));
+
+  // Same pixmap is shared, nothing is rendered again.
+  const QPixmap second = House();
+  QCOMPARE(second.cacheKey(), first.cacheKey());
+  cache = CacheOf(QStringLiteral("pixmap"));
+  QCOMPARE(cache.hits, quint64(1));
+  QCOMPARE(cache.misses, quint64(1));
+  QCOMPARE(cache.entries, 1);
+  const IconHelper::Statistics statistics = IconHelper::statistics();
+  QCOMPARE(statistics.parseTime.count(), quint64(1));
+  QCOMPARE(statistics.rasterizeTime.count(), quint64(1));
+}
+
+void TestIconHelper::cache_uncached() {
+  const QPixmap first = House(false);
+  const QPixmap second = House(false);
+  QVERIFY(second.cacheKey() != first.cacheKey());
+  const IconHelper::CacheStatistics cache = CacheOf(QStringLiteral("pixmap"));
+  QCOMPARE(cache.hits, quint64(0));
+  QCOMPARE(cache.misses, quint64(0));
+  QCOMPARE(cache.entries, 0);
+  QCOMPARE(IconHelper::statistics().parseTime.count(), quint64(2));
+}
+
+void TestIconHelper::cache_limit() {
+  const qint64 bytes = Bytes(House(false));
+  IconHelper::setCacheLimit(2 * bytes);
+  House();
+  Star();
+  IconHelper::pixmap(IconHelper::Solid_check, 16, Qt::red);
+  IconHelper::CacheStatistics cache = CacheOf(QStringLiteral("pixmap"));
+  QCOMPARE(cache.misses, quint64(3));
+  QCOMPARE(cache.evictions, quint64(1));
+  QCOMPARE(cache.entries, 2);
+  QCOMPARE(cache.bytes, 2 * bytes);
+
+  // The oldest one is evicted, and inserting it again evicts the next one.
+  House();
+  cache = CacheOf(QStringLiteral("pixmap"));
+  QCOMPARE(cache.hits, quint64(0));
+  QCOMPARE(cache.misses, quint64(4));
+  QCOMPARE(cache.evictions, quint64(2));
+  QCOMPARE(cache.bytes, 2 * bytes);
+  IconHelper::pixmap(IconHelper::Solid_check, 16, Qt::red);
+  QCOMPARE(CacheOf(QStringLiteral("pixmap")).hits, quint64(1));
+}
+
+void TestIconHelper::cache_oversized() {
+  // An item larger than the limit is kept until the next insertion.
+  IconHelper::setCacheLimit(1);
+  const QPixmap house = House();
+  IconHelper::CacheStatistics cache = CacheOf(QStringLiteral("pixmap"));
+  QCOMPARE(cache.evictions, quint64(0));
+  QCOMPARE(cache.entries, 1);
+  QCOMPARE(cache.bytes, Bytes(house));
+  QCOMPARE(House().cacheKey(), house.cacheKey());
+  QCOMPARE(CacheOf(QStringLiteral("pixmap")).hits, quint64(1));
+
+  Star();
+  cache = CacheOf(QStringLiteral("pixmap"));
+  QCOMPARE(cache.misses, quint64(2));
+  QCOMPARE(cache.evictions, quint64(1));
+  QCOMPARE(cache.entries, 1);
+}
+
+void TestIconHelper::cache_duplicateKey() {
+  // Threads missing the same key both insert, the first value is kept and
+  // counted once against the limit.
+  IconCache<std::tuple<int>, QPixmap> cache("duplicate");
+  QPixmap first(8, 8);
+  first.fill(Qt::red);
+  QPixmap second(8, 8);
+  second.fill(Qt::blue);
+  IconHelper::setCacheLimit(Bytes(first));
+  cache.insert(std::make_tuple(1), first);
+  cache.insert(std::make_tuple(1), second);
+
+  const IconHelper::CacheStatistics statistics = cache.statistics();
+  QCOMPARE(statistics.name, QStringLiteral("duplicate"));
+  QCOMPARE(statistics.entries, 1);
+  QCOMPARE(statistics.bytes, Bytes(first));
+  QCOMPARE(statistics.evictions, quint64(0));
+  QPixmap found;
+  QVERIFY(cache.find(std::make_tuple(1), &found));
+  QCOMPARE(found.cacheKey(), first.cacheKey());
+  QVERIFY(!cache.find(std::make_tuple(2), &found));
+  QCOMPARE(cache.statistics().hits, quint64(1));
+  QCOMPARE(cache.statistics().misses, quint64(1));
+}
+
+void TestIconHelper::cacheLimit_set() {
+  QCOMPARE(IconHelper::cacheLimit(), qint64(0));
+  IconHelper::setCacheLimit(4096);
+  QCOMPARE(IconHelper::cacheLimit(), qint64(4096));
+  IconHelper::setCacheLimit(-1);
+  QCOMPARE(IconHelper::cacheLimit(), qint64(0));
+}
+
+void TestIconHelper::clearCache() {
+  House();
+  Star();
+  IconHelper::clearCache();
+  IconHelper::CacheStatistics cache = CacheOf(QStringLiteral("pixmap"));
+  QCOMPARE(cache.evictions, quint64(2));
+  QCOMPARE(cache.entries, 0);
+  QCOMPARE(cache.bytes, qint64(0));
+
+  IconHelper::resetStatistics();
+  cache = CacheOf(QStringLiteral("pixmap"));
+  QCOMPARE(cache.misses, quint64(0));
+  QCOMPARE(cache.evictions, quint64(0));
+  QCOMPARE(IconHelper::statistics().parseTime.count(), quint64(0));
+}
+
+void TestIconHelper::statistics_topKeys() {
+  House();
+  House();
+  House();
+  Star();
+  IconHelper::Statistics statistics = IconHelper::statistics(1);
+  QCOMPARE(statistics.topKeys.size(), 1);
+  QCOMPARE(statistics.topKeys[0].first,
+           QStringLiteral("pixmap(Solid_house,16,#ffff0000,true)"));
+  QCOMPARE(statistics.topKeys[0].second, quint64(3));
+
+  statistics = IconHelper::statistics(5);
+  QCOMPARE(statistics.topKeys.size(), 2);
+  QCOMPARE(statistics.topKeys[1].first,
+           QStringLiteral("pixmap(Solid_star,16,#ffff0000,true)"));
+  QCOMPARE(statistics.topKeys[1].second, quint64(1));
+  QCOMPARE(IconHelper::statistics(0).topKeys.size(), 0);
+}
+
+void TestIconHelper::statistics_toJson() {
+  const qint64 bytes = Bytes(House());
+  House();
+  const QJsonObject json = IconHelper::statistics().toJson();
+
+  QJsonObject pixmap;
+  const QJsonArray caches = json.value(QStringLiteral("caches")).toArray();
+  for (const QJsonValue& cache : caches) {
+    if (cache[QStringLiteral("name")].toString() == QStringLiteral("pixmap")) {
+      pixmap = cache.toObject();
+    }
+  }
+  QCOMPARE(pixmap.value(QStringLiteral("hits")).toInt(), 1);
+  QCOMPARE(pixmap.value(QStringLiteral("misses")).toInt(), 1);
+  QCOMPARE(pixmap.value(QStringLiteral("evictions")).toInt(), 0);
+  QCOMPARE(pixmap.value(QStringLiteral("entries")).toInt(), 1);
+  QCOMPARE(qint64(pixmap.value(QStringLiteral("bytes")).toDouble()), bytes);
+
+  const QJsonObject parseTime =
+      json.value(QStringLiteral("parseTime")).toObject();
+  QCOMPARE(parseTime.value(QStringLiteral("count")).toInt(), 1);
+  const QJsonArray topKeys = json.value(QStringLiteral("topKeys")).toArray();
+  QCOMPARE(topKeys.size(), 1);
+  QCOMPARE(topKeys[0][QStringLiteral("key")].toString(),
+           QStringLiteral("pixmap(Solid_house,16,#ffff0000,true)"));
+  QCOMPARE(topKeys[0][QStringLiteral("requests")].toInt(), 2);
+}
+
+void TestIconHelper::composite_overlay() {
+  const QImage base = House().toImage();
+  const QPixmap composed =
+      IconHelper::composite(IconHelper::Solid_house, IconHelper::Solid_star);
+  QCOMPARE(composed.size(), QSize(16, 16));
+  QCOMPARE(composed.devicePixelRatio(), 1.0);
+  QVERIFY(composed.toImage() != base);
+  // Overlay is drawn on a copy, cached base pixmap is not changed.
+  QCOMPARE(House().toImage(), base);
+  IconHelper::CacheStatistics cache = CacheOf(QStringLiteral("composite"));
+  QCOMPARE(cache.misses, quint64(1));
+  QCOMPARE(cache.entries, 1);
+  QCOMPARE(cache.bytes, Bytes(composed));
+
+  const QPixmap again =
+      IconHelper::composite(IconHelper::Solid_house, IconHelper::Solid_star);
+  QCOMPARE(again.cacheKey(), composed.cacheKey());
+  cache = CacheOf(QStringLiteral("composite"));
+  QCOMPARE(cache.hits, quint64(1));
+  QCOMPARE(cache.misses, quint64(1));
+
+  // Other overlays, colors and corners have their own keys.
+  const QPixmap check =
+      IconHelper::composite(IconHelper::Solid_house, IconHelper::Solid_check);
+  QVERIFY(check.cacheKey() != composed.cacheKey());
+  IconHelper::composite(IconHelper::Solid_house, IconHelper::Solid_star, 16,
+                        Qt::white, Qt::blue);
+  IconHelper::composite(IconHelper::Solid_house, IconHelper::Solid_star, 16,
+                        Qt::white, Qt::red, Qt::TopLeftCorner);
+  cache = CacheOf(QStringLiteral("composite"));
+  QCOMPARE(cache.hits, quint64(1));
+  QCOMPARE(cache.misses, quint64(4));
+  QCOMPARE(cache.entries, 4);
+  const IconHelper::Statistics statistics = IconHelper::statistics(100);
+  QCOMPARE(statistics.topKeys.count(qMakePair(
+               QStringLiteral("composite(Solid_house,Solid_star,16,#ffffffff,"
+                              "#ffff0000,3,true)"),
+               quint64(2))),
+           1);
+
+  // Size of overlay is half of the base, at least 1 pixel.
+  QCOMPARE(IconHelper::composite(IconHelper::Solid_house,
+                                 IconHelper::Solid_star, 1)
+               .size(),
+           QSize(1, 1));
+  const QPixmap uncached =
+      IconHelper::composite(IconHelper::Solid_house, IconHelper::Solid_star,
+                            32, Qt::white, Qt::red, Qt::BottomRightCorner,
+                            false);
+  QCOMPARE(uncached.size(), QSize(32, 32));
+  QCOMPARE(CacheOf(QStringLiteral("composite")).entries, 5);
+}
+
+void TestIconHelper::composite_badge() {
+  const QImage base = House().toImage();
+  const QPixmap one =
+      IconHelper::composite(IconHelper::Solid_house, QStringLiteral("1"));
+  QCOMPARE(one.size(), QSize(16, 16));
+  QCOMPARE(one.devicePixelRatio(), 1.0);
+  QVERIFY(one.toImage() != base);
+  QCOMPARE(House().toImage(), base);
+  QCOMPARE(
+      IconHelper::composite(IconHelper::Solid_house, QStringLiteral("1"))
+          .cacheKey(),
+      one.cacheKey());
+  IconHelper::CacheStatistics cache = CacheOf(QStringLiteral("badge"));
+  QCOMPARE(cache.hits, quint64(1));
+  QCOMPARE(cache.misses, quint64(1));
+  QCOMPARE(cache.entries, 1);
+
+  // Each text has its own key, and does not hit the overlay cache.
+  const QPixmap two =
+      IconHelper::composite(IconHelper::Solid_house, QStringLiteral("2"));
+  QVERIFY(two.cacheKey() != one.cacheKey());
+  const QPixmap many =
+      IconHelper::composite(IconHelper::Solid_house, QStringLiteral("99+"));
+  QCOMPARE(many.size(), QSize(16, 16));
+  cache = CacheOf(QStringLiteral("badge"));
+  QCOMPARE(cache.hits, quint64(1));
+  QCOMPARE(cache.misses, quint64(3));
+  QCOMPARE(cache.entries, 3);
+  QCOMPARE(CacheOf(QStringLiteral("composite")).misses, quint64(0));
+  const IconHelper::Statistics statistics = IconHelper::statistics(100);
+  QCOMPARE(statistics.topKeys.count(qMakePair(
+               QStringLiteral("badge(Solid_house,99+,16,#ffffffff,#ffffffff,"
+                              "#ffff0000,1,true)"),
+               quint64(1))),
+           1);
+}
+
+void TestIconHelper::animation_frames() {
+  QCOMPARE(IconHelper::animationFrameCount(IconHelper::Spin), 24);
+  QCOMPARE(IconHelper::animationFrameCount(IconHelper::Pulse), 8);
+  const QPixmap strip =
+      IconHelper::animationStrip(IconHelper::Solid_spinner, 16, Qt::red);
+  QCOMPARE(strip.size(), QSize(16 * 24, 16));
+  QCOMPARE(
+      IconHelper::animationStrip(IconHelper::Solid_spinner, 16, Qt::red)
+          .cacheKey(),
+      strip.cacheKey());
+
+  // Rendered again with the same pixels.
+  const QImage image = strip.toImage();
+  IconHelper::clearCache();
+  QCOMPARE(
+      IconHelper::animationStrip(IconHelper::Solid_spinner, 16, Qt::red)
+          .toImage(),
+      image);
+
+  // Current frame is one of the frames in the strip.
+  const QImage frame =
+      IconHelper::animationFrame(IconHelper::Solid_spinner, 16, Qt::red)
+          .toImage();
+  QCOMPARE(frame.size(), QSize(16, 16));
+  bool found = false;
+  for (int i = 0; i < 24; ++i) {
+    found = found || (image.copy(i * 16, 0, 16, 16) == frame);
+  }
+  QVERIFY(found);
+}
+
+void TestIconHelper::animation_sharedClock() {
+  QPushButton first;
+  QPushButton second;
+  first.show();
+  second.show();
+  IconHelper::SetAnimatedIcon(&first, IconHelper::Solid_spinner, 16, Qt::red);
+  IconHelper::SetAnimatedIcon(&second, IconHelper::Solid_spinner, 16,
+                              Qt::red, IconHelper::Pulse);
+  QVERIFY(!first.icon().isNull());
+
+  // One clock with one timer drives both widgets.
+  QTimer* timer = AnimationTimer();
+  QVERIFY(timer);
+  QVERIFY(timer->isActive());
+  QCOMPARE(timer->interval(), 40);
+  QCOMPARE(QCoreApplication::instance()
+               ->findChildren<QObject*>(
+                   QStringLiteral("KtUtils::AnimationClock"))
+               .size(),
+           1);
+  QCOMPARE(timer->parent()->findChildren<QTimer*>().size(), 1);
+  const qint64 firstKey = first.icon().cacheKey();
+  const qint64 secondKey = second.icon().cacheKey();
+  QTRY_VERIFY(first.icon().cacheKey() != firstKey);
+  QTRY_VERIFY(second.icon().cacheKey() != secondKey);
+
+  // Clock keeps running for the remaining widget, and stops after the last
+  // one is removed.
+  IconHelper::StopAnimation(&first);
+  QTest::qWait(100);
+  QVERIFY(timer->isActive());
+  const qint64 stoppedKey = first.icon().cacheKey();
+  IconHelper::StopAnimation(&second);
+  QTRY_VERIFY(!timer->isActive());
+  QCOMPARE(first.icon().cacheKey(), stoppedKey);
+
+  IconHelper::StartAnimation(&first);
+  QCOMPARE(AnimationTimer(), timer);
+  QVERIFY(timer->isActive());
+  IconHelper::StopAnimation(&first);
+  QTRY_VERIFY(!timer->isActive());
+}
+
+void TestIconHelper::animation_hidden() {
+  QPushButton visible;
+  QPushButton hidden;
+  visible.show();
+  IconHelper::SetAnimatedIcon(&visible, IconHelper::Solid_spinner, 16,
+                              Qt::red);
+  IconHelper::SetAnimatedIcon(&hidden, IconHelper::Solid_spinner, 16,
+                              Qt::red);
+  const qint64 visibleKey = visible.icon().cacheKey();
+  const qint64 hiddenKey = hidden.icon().cacheKey();
+
+  // Ticks of the clock skip the hidden widget.
+  QTRY_VERIFY(visible.icon().cacheKey() != visibleKey);
+  QTest::qWait(100);
+  QCOMPARE(hidden.icon().cacheKey(), hiddenKey);
+
+  // And update it once it is shown.
+  hidden.show();
+  QTRY_VERIFY(hidden.icon().cacheKey() != hiddenKey);
+  IconHelper::StopAnimation(&visible);
+  IconHelper::StopAnimation(&hidden);
+  QTRY_VERIFY(!AnimationTimer()->isActive());
+}
+
+void TestIconHelper::animation_destroyed() {
+  QScopedPointer<QPushButton> button(new QPushButton);
+  button->show();
+  IconHelper::SetAnimatedIcon(button.data(), IconHelper::Solid_spinner, 16,
+                              Qt::red);
+  QTimer* timer = AnimationTimer();
+  QVERIFY(timer);
+  QVERIFY(timer->isActive());
+
+  // Destroyed widgets are removed without StopAnimation.
+  button.reset();
+  QTRY_VERIFY(!timer->isActive());
+}
+
+QTEST_MAIN(TestIconHelper)
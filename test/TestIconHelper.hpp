@@ -0,0 +1,31 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_ICONHELPER_HPP
+#define KTUTILS_TEST_ICONHELPER_HPP
+
+class TestIconHelper : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void init();
+
+  void cache_hitMiss();
+  void cache_uncached();
+  void cache_limit();
+  void cache_oversized();
+  void cache_duplicateKey();
+  void cacheLimit_set();
+  void clearCache();
+  void statistics_topKeys();
+  void statistics_toJson();
+
+  void composite_overlay();
+  void composite_badge();
+
+  void animation_frames();
+  void animation_sharedClock();
+  void animation_hidden();
+  void animation_destroyed();
+};
+
+#endif  // KTUTILS_TEST_ICONHELPER_HPP
@@ -0,0 +1,374 @@
+﻿#include "TestJson.hpp"
+#include <QtTest/QtTest>
+
+using namespace KtUtils;
+
+// Write json into a temporary file, which is removed with the returned file.
+static QTemporaryFile* WriteTemporary(const QJsonValue& json) {
+  auto file = new QTemporaryFile;
+  if (file->open()) {
+    file->write(json.isArray()
+                    ? QJsonDocument(json.toArray()).toJson()
+                    : QJsonDocument(json.toObject()).toJson());
+    file->close();
+  }
+  return file;
+}
+
+void TestJson::toStandardItem_itemData() {
+  QStandardItemModel model;
+  model.appendRow(Json::toStandardItem(
+      QJsonObject{{QStringLiteral("key"), 42}}, QStringLiteral("root")));
+  const QModelIndex value = model.index(0, 1, model.index(0, 0));
+
+  // Value is in the item's own store, seen by itemData() and streaming.
+  QMap<int, QVariant> roles = model.itemData(value);
+  QCOMPARE(roles.value(Qt::DisplayRole), QVariant(42.0));
+  QCOMPARE(value.data(Qt::EditRole), QVariant(42.0));
+  QCOMPARE(value.data(Qt::AccessibleTextRole), QVariant(42.0));
+  QScopedPointer<QMimeData> mimeData(model.mimeData({value}));
+  QVERIFY(mimeData->hasFormat(
+      QStringLiteral("application/x-qstandarditemmodeldatalist")));
+
+  roles[Qt::DisplayRole] = 7;
+  QVERIFY(model.setItemData(value, roles));
+  QCOMPARE(value.data(Qt::DisplayRole), QVariant(7));
+  QCOMPARE(value.data(Qt::AccessibleTextRole), QVariant(7));
+}
+
+// Lines of "depth type:name [type:value]" for each row, in order.
+static void DumpRow(QStandardItem* col0, QStandardItem* col1, int depth,
+                    QStringList* lines) {
+  const QVariant name = col0->data(Qt::DisplayRole);
+  QString line = QStringLiteral("%1 %2:%3")
+                     .arg(depth)
+                     .arg(QString::fromLatin1(name.typeName()))
+                     .arg(name.toString());
+  if (col1) {
+    const QVariant value = col1->data(Qt::DisplayRole);
+    line += QStringLiteral(" %1:%2")
+                .arg(QString::fromLatin1(value.typeName()))
+                .arg(value.toString());
+  }
+  *lines << line;
+  for (int i = 0; i < col0->rowCount(); ++i) {
+    DumpRow(col0->child(i, 0), col0->child(i, 1), depth + 1, lines);
+  }
+}
+
+static QStringList Dump(const QList<QStandardItem*>& row) {
+  QStringList lines;
+  DumpRow(row.value(0), row.value(1), 0, &lines);
+  qDeleteAll(row);
+  return lines;
+}
+
+// Occupies a pool thread until released.
+class BlockingRunnable : public QRunnable {
+ public:
+  explicit BlockingRunnable(QSemaphore& release) : release(release) {}
+  void run() override { release.acquire(); }
+
+ private:
+  QSemaphore& release;
+};
+
+// Object members of all kinds of values, with large arrays to split.
+static QJsonObject MakeDocument(int members) {
+  QJsonObject document;
+  for (int i = 0; i < members; ++i) {
+    QJsonArray items;
+    for (int j = 0; j < 100; ++j) {
+      items << j << QJsonValue() << QStringLiteral("s%1").arg(j)
+            << QJsonArray() << QJsonObject{{QStringLiteral("b"), true}};
+    }
+    // Keys are not inserted in order.
+    document.insert(QStringLiteral("member%1").arg(members - i),
+                    QJsonObject{{QStringLiteral("z"), QJsonValue()},
+                                {QStringLiteral("a"), items},
+                                {QStringLiteral("m"), 1.5}});
+  }
+  return document;
+}
+
+void TestJson::toStandardItem_parallel() {
+  const QJsonObject document = MakeDocument(50);
+  const QStringList expected =
+      Dump(Json::toStandardItem(document, QStringLiteral("root")));
+  QVERIFY(expected.size() > 50 * 500);
+
+  // Split at root, at members, and down to single values.
+  for (int threshold : {1, 16, 1000, 1 << 30}) {
+    QCOMPARE(Dump(Json::toStandardItem(document, QStringLiteral("root"),
+                                       threshold)),
+             expected);
+  }
+  QCOMPARE(Dump(Json::toStandardItem(QJsonArray{QJsonValue(), 1}, QString(),
+                                     1)),
+           Dump(Json::toStandardItem(QJsonArray{QJsonValue(), 1})));
+}
+
+void TestJson::toStandardItem_parallel_busyPool() {
+  const QJsonObject document = MakeDocument(20);
+  const QStringList expected =
+      Dump(Json::toStandardItem(document, QStringLiteral("root")));
+
+  // Helpers can't start, calling thread builds all units.
+  QThreadPool pool;
+  pool.setMaxThreadCount(1);
+  QSemaphore release;
+  pool.start(new BlockingRunnable(release));
+  BlockingRunnable probe(release);
+  probe.setAutoDelete(false);
+  QVERIFY(!pool.tryStart(&probe));
+  QCOMPARE(Dump(Json::toStandardItem(document, QStringLiteral("root"), 16,
+                                     &pool)),
+           expected);
+  release.release();
+  pool.waitForDone();
+}
+
+static const QJsonObject kDocument{
+    {QStringLiteral("name"), QStringLiteral("KtUtils")},
+    {QStringLiteral("items"), QJsonArray{1, 2.5, true, QJsonValue()}}};
+
+void TestJson::fromFile_mapped() {
+  QScopedPointer<QTemporaryFile> file(WriteTemporary(kDocument));
+  QString errorString;
+  const QJsonDocument doc = Json::fromFile(file->fileName(), &errorString);
+  QVERIFY2(!doc.isNull(), qPrintable(errorString));
+  QCOMPARE(doc.object(), kDocument);
+
+  // Empty file can't be mapped, and is read as invalid document.
+  QTemporaryFile empty;
+  QVERIFY(empty.open());
+  QVERIFY(Json::fromFile(empty.fileName(), &errorString).isNull());
+  QVERIFY(!errorString.isEmpty());
+}
+
+void TestJson::fromFile_error() {
+  QString errorString;
+  QVERIFY(Json::fromFile(QStringLiteral("/nonexistent/KtUtils.json"),
+                         &errorString)
+              .isNull());
+  QVERIFY(!errorString.isEmpty());
+
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  file.write("{\"key\": }");
+  file.close();
+  errorString.clear();
+  QVERIFY(Json::fromFile(file.fileName(), &errorString).isNull());
+  QVERIFY(errorString.startsWith(QStringLiteral("Json parse error at pos")));
+}
+
+void TestJson::fromDevice_buffer() {
+  // Larger than one read chunk, read by the streaming fallback.
+  QJsonArray items;
+  for (int i = 0; i < 200000; ++i) items << i;
+  QByteArray data = QJsonDocument(items).toJson();
+  QVERIFY(data.size() > (1 << 20));
+  QBuffer buffer(&data);
+  QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+  QString errorString;
+  const QJsonDocument doc = Json::fromDevice(buffer, &errorString);
+  QVERIFY2(!doc.isNull(), qPrintable(errorString));
+  QCOMPARE(doc.array(), items);
+  QVERIFY(buffer.atEnd());
+}
+
+void TestJson::fromDevice_pos_data() {
+  QTest::addColumn<bool>("mapped");
+  QTest::newRow("file") << true;
+  QTest::newRow("buffer") << false;
+}
+
+void TestJson::fromDevice_pos() {
+  QFETCH(bool, mapped);
+  static const QByteArray kHeader = "header\n";
+  const QByteArray data = kHeader + QJsonDocument(kDocument).toJson();
+
+  QTemporaryFile file;
+  QByteArray bufferData = data;
+  QBuffer buffer(&bufferData);
+  QIODevice* device = &buffer;
+  if (mapped) {
+    QVERIFY(file.open());
+    file.write(data);
+    device = &file;
+  } else {
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+  }
+
+  // Document starts at current position, which ends at device end.
+  QVERIFY(device->seek(kHeader.size()));
+  QString errorString;
+  const QJsonDocument doc = Json::fromDevice(*device, &errorString);
+  QVERIFY2(!doc.isNull(), qPrintable(errorString));
+  QCOMPARE(doc.object(), kDocument);
+  QCOMPARE(device->pos(), qint64(data.size()));
+}
+
+// Fetch all rows under parent, like a view expanding every row.
+static void FetchAll(QAbstractItemModel* model, const QModelIndex& parent) {
+  while (model->canFetchMore(parent)) model->fetchMore(parent);
+  for (int row = 0; row < model->rowCount(parent); ++row) {
+    FetchAll(model, model->index(row, 0, parent));
+  }
+}
+
+void TestJson::model_tester() {
+  Json::Model model;
+  QAbstractItemModelTester tester(
+      &model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+  QJsonObject document = MakeDocument(3);
+  QJsonArray large;
+  for (int i = 0; i < 600; ++i) large << i;
+  document.insert(QStringLiteral("large"), large);
+  model.setJson(document, QStringLiteral("root"));
+  FetchAll(&model, {});
+  QVERIFY(!QTest::currentTestFailed());
+
+  // Same rows as toStandardItem().
+  const QModelIndex root = model.index(0, 0);
+  QCOMPARE(root.data().toString(), QStringLiteral("root"));
+  QCOMPARE(model.rowCount(root), document.size());
+  QCOMPARE(model.json(), QJsonValue(document));
+  QStandardItemModel items;
+  items.appendRow(Json::toStandardItem(document, QStringLiteral("root")));
+  const QModelIndex member = model.index(0, 0, root);
+  QCOMPARE(member.data(), items.index(0, 0, items.index(0, 0)).data());
+  QCOMPARE(model.value(member), document.constBegin().value());
+
+  model.setJson(QJsonValue(1), QStringLiteral("scalar"));
+  QCOMPARE(model.rowCount(), 1);
+  QCOMPARE(model.index(0, 1).data(), QVariant(1.0));
+  QVERIFY(!model.hasChildren(model.index(0, 0)));
+}
+
+void TestJson::model_fetchMore() {
+  static constexpr int kCount = 600;
+  QJsonArray array;
+  QJsonObject object;
+  for (int i = 0; i < kCount; ++i) {
+    array << i;
+    object.insert(QStringLiteral("key%1").arg(i), i);
+  }
+  const QStringList keys = object.keys();
+
+  Json::Model model;
+  QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+  for (const QJsonValue& json : {QJsonValue(array), QJsonValue(object)}) {
+    model.setJson(json);
+    inserted.clear();
+    const QModelIndex top = model.index(0, 0);
+    QVERIFY(model.hasChildren(top));
+    QCOMPARE(model.rowCount(top), 0);
+
+    // Rows are fetched in batches of 256.
+    for (int fetched : {256, 512, kCount}) {
+      QVERIFY(model.canFetchMore(top));
+      model.fetchMore(top);
+      QCOMPARE(model.rowCount(top), fetched);
+    }
+    QVERIFY(!model.canFetchMore(top));
+    model.fetchMore(top);
+    QCOMPARE(model.rowCount(top), kCount);
+    QCOMPARE(inserted.size(), 3);
+    QCOMPARE(inserted.at(1).at(1).toInt(), 256);
+    QCOMPARE(inserted.at(1).at(2).toInt(), 511);
+
+    // Rows continue across the batch boundary in json order.
+    for (int row : {255, 256, 511, 512, kCount - 1}) {
+      const QModelIndex index = model.index(row, 0, top);
+      if (json.isArray()) {
+        QCOMPARE(index.data(), QVariant(row));
+      } else {
+        QCOMPARE(index.data().toString(), keys.at(row));
+      }
+      QCOMPARE(model.parent(index), top);
+      QCOMPARE(model.value(index),
+               json.isArray() ? array.at(row) : object.value(keys.at(row)));
+    }
+  }
+}
+
+void TestJson::loadAsync_split() {
+  static constexpr int kCount = 40000;
+  QJsonArray items;
+  for (int i = 0; i < kCount; ++i) items << i;
+  QScopedPointer<QTemporaryFile> file(
+      WriteTemporary(QJsonObject{{QStringLiteral("data"), items}}));
+
+  // Large member is appended before its children.
+  QStandardItemModel model;
+  int childrenWhenInserted = -1;
+  connect(&model, &QAbstractItemModel::rowsInserted,
+          [&model, &childrenWhenInserted](const QModelIndex& parent,
+                                          int first, int) {
+            if (parent.isValid() && !parent.parent().isValid() &&
+                (first == 0)) {
+              childrenWhenInserted =
+                  model.rowCount(model.index(0, 0, parent));
+            }
+          });
+
+  Json::LoadTask* task = Json::loadAsync(file->fileName(), &model);
+  QSignalSpy finished(task, &Json::LoadTask::finished);
+  QVERIFY(finished.wait(10000));
+  QCOMPARE(finished.first().first().toBool(), true);
+  QCOMPARE(childrenWhenInserted, 0);
+  QCOMPARE(task->nodesBuilt(), qint64(kCount + 2));
+
+  QCOMPARE(model.rowCount(), 1);
+  QStandardItem* data = model.item(0)->child(0);
+  QCOMPARE(data->text(), QStringLiteral("data"));
+  QCOMPARE(data->rowCount(), kCount);
+  QCOMPARE(data->child(kCount - 1, 1)->data(Qt::DisplayRole).toInt(),
+           kCount - 1);
+}
+
+void TestJson::loadAsync_cancel() {
+  QJsonArray items;
+  for (int i = 0; i < 100000; ++i) items << i;
+  QScopedPointer<QTemporaryFile> file(WriteTemporary(items));
+
+  QStandardItemModel model;
+  Json::LoadTask* task = Json::loadAsync(file->fileName(), &model);
+  QSignalSpy finished(task, &Json::LoadTask::finished);
+  task->cancel();
+  QVERIFY(finished.wait(10000));
+  QCOMPARE(finished.first().first().toBool(), false);
+  QVERIFY(task->isCanceled());
+  QVERIFY(task->errorString().isEmpty());
+  // Rows loaded partially are removed.
+  QCOMPARE(model.rowCount(), 0);
+}
+
+void TestJson::loadAsync_progress() {
+  QScopedPointer<QTemporaryFile> file(WriteTemporary(kDocument));
+  QStandardItemModel model;
+  Json::LoadTask* task = Json::loadAsync(file->fileName(), &model);
+  QSignalSpy progress(task, &Json::LoadTask::progress);
+  QSignalSpy finished(task, &Json::LoadTask::finished);
+  QVERIFY(finished.wait(10000));
+  QCOMPARE(finished.first().first().toBool(), true);
+
+  // Mapped size is reported before parsing, reported again when finished.
+  QVERIFY(progress.count() >= 2);
+  QCOMPARE(progress.last().first().toLongLong(), file->size());
+  QCOMPARE(task->bytesRead(), file->size());
+}
+
+void TestJson::loadAsync_nullModel() {
+  QScopedPointer<QTemporaryFile> file(WriteTemporary(kDocument));
+  QTest::ignoreMessage(QtWarningMsg, "Json::loadAsync: model is nullptr");
+  QVERIFY(!Json::loadAsync(file->fileName(),
+                           static_cast<QStandardItemModel*>(nullptr)));
+  QTest::ignoreMessage(QtWarningMsg, "Json::loadAsync: model is nullptr");
+  QVERIFY(
+      !Json::loadAsync(file->fileName(), static_cast<Json::Model*>(nullptr)));
+}
+
+QTEST_GUILESS_MAIN(TestJson)
@@ -0,0 +1,29 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_JSON_HPP
+#define KTUTILS_TEST_JSON_HPP
+
+class TestJson : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void toStandardItem_itemData();
+  void toStandardItem_parallel();
+  void toStandardItem_parallel_busyPool();
+
+  void fromFile_mapped();
+  void fromFile_error();
+  void fromDevice_buffer();
+  void fromDevice_pos();
+  void fromDevice_pos_data();
+
+  void model_tester();
+  void model_fetchMore();
+
+  void loadAsync_split();
+  void loadAsync_cancel();
+  void loadAsync_progress();
+  void loadAsync_nullModel();
+};
+
+#endif  // KTUTILS_TEST_JSON_HPP
@@ -0,0 +1,290 @@
+﻿#include "TestLogging.hpp"
+#include <QtConcurrent/QtConcurrent>
+#include <QtTest/QtTest>
+
+using namespace KtUtils;
+
+// Set by async_fatal() for the child process running async_fatal_child().
+static const char kFatalOutputEnv[] = "KTUTILS_TEST_FATAL_OUTPUT";
+
+namespace {
+// Records written by MemoryLogSink, outlives the sink owned by the logger.
+struct MemoryLog {
+  QMutex mutex;
+  QVector<LogRecord> records;
+  // Optionally blocks write() of first record until released.
+  QSemaphore entered;
+  QSemaphore gate;
+  bool blockFirst = false;
+
+  QStringList texts() {
+    QMutexLocker locker(&mutex);
+    QStringList ret;
+    for (const LogRecord& record : records) ret << record.text();
+    return ret;
+  }
+};
+
+class MemoryLogSink : public LogSink {
+ public:
+  explicit MemoryLogSink(std::shared_ptr<MemoryLog> log)
+      : log(std::move(log)) {}
+
+  void write(const LogRecord& record) override {
+    bool block = false;
+    {
+      QMutexLocker locker(&log->mutex);
+      log->records << record;
+      block = log->blockFirst && (log->records.size() == 1);
+    }
+    if (block) {
+      log->entered.release();
+      log->gate.acquire();
+    }
+  }
+
+ private:
+  std::shared_ptr<MemoryLog> log;
+};
+
+// Drops records, for benchmarks of logging threads only.
+class NullLogSink : public LogSink {
+ public:
+  void write(const LogRecord&) override {}
+};
+}  // namespace
+
+void TestLogging::cleanup() { uninstallAsyncMessageHandler(); }
+
+void TestLogging::async_flush() {
+  static constexpr int kThreads = 4;
+  static constexpr int kCount = 100;
+  auto log = std::make_shared<MemoryLog>();
+  installAsyncMessageHandler(
+      std::unique_ptr<LogSink>(new MemoryLogSink(log)));
+
+  QVector<QFuture<void>> futures;
+  for (int i = 0; i < kThreads; ++i) {
+    futures << QtConcurrent::run([i] {
+      for (int j = 0; j < kCount; ++j) qWarning("thread %d message %d", i, j);
+    });
+  }
+  for (auto& future : futures) future.waitForFinished();
+  KTUTILS_LOG(QtInfoMsg, "binary %1 %2", 42, "argument");
+  flushAsyncMessages();
+
+  const QStringList texts = log->texts();
+  QCOMPARE(texts.size(), kThreads * kCount + 1);
+  QVERIFY(texts.contains(QStringLiteral("thread 3 message 99")));
+  QCOMPARE(texts.last(), QStringLiteral("binary 42 argument"));
+  QCOMPARE(droppedAsyncMessages(), quint64(0));
+  {
+    QMutexLocker locker(&log->mutex);
+    QCOMPARE(QByteArray(log->records.first().file), QByteArray(__FILE__));
+  }
+
+  // Nothing is queued after uninstalled.
+  uninstallAsyncMessageHandler();
+  QTest::ignoreMessage(QtWarningMsg, "after uninstalled");
+  qWarning("after uninstalled");
+  QCOMPARE(log->texts().size(), kThreads * kCount + 1);
+}
+
+void TestLogging::async_temporaryContext() {
+  auto log = std::make_shared<MemoryLog>();
+  installAsyncMessageHandler(
+      std::unique_ptr<LogSink>(new MemoryLogSink(log)));
+  {
+    QByteArray file("temporary.cpp");
+    QByteArray function("temporaryFunction()");
+    QByteArray category("temporary.category");
+    QMessageLogger(file.constData(), 42, function.constData(),
+                   category.constData())
+        .warning("temporary context");
+    // Overwrite before the record is written.
+    file.fill('x');
+    function.fill('x');
+    category.fill('x');
+  }
+  flushAsyncMessages();
+
+  QMutexLocker locker(&log->mutex);
+  QCOMPARE(log->records.size(), 1);
+  const LogRecord& record = log->records.first();
+  QCOMPARE(QByteArray(record.file), QByteArray("temporary.cpp"));
+  QCOMPARE(QByteArray(record.function), QByteArray("temporaryFunction()"));
+  QCOMPARE(QByteArray(record.category), QByteArray("temporary.category"));
+  QCOMPARE(record.line, 42);
+}
+
+void TestLogging::async_dropped() {
+  static constexpr int kCapacity = 4;
+  static constexpr int kCount = 100;
+  auto log = std::make_shared<MemoryLog>();
+  log->blockFirst = true;
+  installAsyncMessageHandler(
+      std::unique_ptr<LogSink>(new MemoryLogSink(log)), kCapacity);
+
+  // Background thread is blocked writing the first record, ring buffer of
+  // this thread keeps only kCapacity records meanwhile.
+  qWarning("first");
+  QVERIFY(log->entered.tryAcquire(1, 5000));
+  for (int i = 0; i < kCount; ++i) qWarning("queued %d", i);
+  QCOMPARE(droppedAsyncMessages(), quint64(kCount - kCapacity));
+  log->gate.release();
+  flushAsyncMessages();
+
+  const QStringList texts = log->texts();
+  QCOMPARE(texts.size(), 1 + kCapacity + 1);
+  QCOMPARE(texts[kCapacity], QStringLiteral("queued %1").arg(kCapacity - 1));
+  QCOMPARE(texts.last(),
+           QStringLiteral("%1 log records dropped, ring buffer is full")
+               .arg(kCount - kCapacity));
+}
+
+void TestLogging::async_fatal() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString output = dir.filePath(QStringLiteral("fatal.log"));
+  QProcess process;
+  QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+  environment.insert(QString::fromLatin1(kFatalOutputEnv), output);
+  process.setProcessEnvironment(environment);
+  process.start(QCoreApplication::applicationFilePath(),
+                {QStringLiteral("async_fatal_child")});
+  QVERIFY(process.waitForFinished(10000));
+  QVERIFY((process.exitStatus() == QProcess::CrashExit) ||
+          (process.exitCode() != 0));
+
+  // Queued records are written before the fatal message.
+  QFile file(output);
+  QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+  const QList<QByteArray> lines = file.readAll().trimmed().split('\n');
+  QCOMPARE(lines.size(), 2);
+  QVERIFY(lines[0].contains("warning") && lines[0].contains("before fatal"));
+  QVERIFY(lines[1].contains("fatal") && lines[1].contains("fatal message"));
+}
+
+void TestLogging::async_fatal_child() {
+  const QByteArray output = qgetenv(kFatalOutputEnv);
+  if (output.isEmpty()) QSKIP("Run by async_fatal()");
+  FILE* stream = fopen(output.constData(), "w");
+  QVERIFY(stream);
+  installAsyncMessageHandler(
+      std::unique_ptr<LogSink>(new TextLogSink(stream)));
+  qWarning("before fatal");
+  qFatal("fatal message");
+}
+
+void TestLogging::async_benchmark() {
+  static constexpr int kThreads = 4;
+  static constexpr int kCount = 1000;
+  // A pool thread may run all tasks of an iteration.
+  installAsyncMessageHandler(std::unique_ptr<LogSink>(new NullLogSink),
+                             kThreads * kCount);
+
+  // Threads of the pool log concurrently through the installed handler.
+  QThreadPool pool;
+  pool.setMaxThreadCount(kThreads);
+  QBENCHMARK {
+    QVector<QFuture<void>> futures;
+    for (int i = 0; i < kThreads; ++i) {
+      futures << QtConcurrent::run(&pool, [] {
+        for (int j = 0; j < kCount; ++j) qWarning("benchmark message %d", j);
+      });
+    }
+    for (auto& future : futures) future.waitForFinished();
+    flushAsyncMessages();
+  }
+  QCOMPARE(droppedAsyncMessages(), quint64(0));
+}
+
+void TestLogging::binary_roundTrip() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString path = dir.filePath(QStringLiteral("binary.log"));
+
+  // Strings of records are not kept, file and function are compared with
+  // expected values.
+  QVector<LogRecord> written;
+  {
+    BinaryLogSink sink(path);
+    QVERIFY(sink.isOpen());
+
+    LogRecord record;
+    record.type = QtWarningMsg;
+    record.timestamp = 1000000;
+    record.thread = 0x1234;
+    record.category = "default";
+    record.file = "first.cpp";
+    record.line = 10;
+    record.function = "first()";
+    record.message = QStringLiteral("text message");
+    sink.write(record);
+    written << record;
+
+    QByteArray file("second.cpp");
+    record.type = QtInfoMsg;
+    record.file = file.constData();
+    record.line = 20;
+    record.message.clear();
+    record.format = "%1 and %2";
+    QDataStream stream(&record.arguments, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << QVariant(42) << QVariant(QStringLiteral("argument"));
+    sink.write(record);
+    written << record;
+
+    // Another string at the same address, e.g. of a freed string reused.
+    file.replace(0, 6, "reused");
+    QVERIFY(record.file == file.constData());
+    record.format = nullptr;
+    record.arguments.clear();
+    record.message = QStringLiteral("after reuse");
+    sink.write(record);
+    written << record;
+    sink.flush();
+  }
+
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  BinaryLogReader reader(&file);
+  QVERIFY(reader.isValid());
+  const QList<QByteArray> files = {"first.cpp", "second.cpp", "reused.cpp"};
+  for (int i = 0; i < written.size(); ++i) {
+    LogRecord record;
+    QVERIFY(reader.read(&record));
+    QCOMPARE(record.type, written[i].type);
+    QCOMPARE(record.timestamp, written[i].timestamp);
+    QCOMPARE(record.thread, written[i].thread);
+    QCOMPARE(QByteArray(record.category), QByteArray("default"));
+    QCOMPARE(QByteArray(record.file), files[i]);
+    QCOMPARE(record.line, written[i].line);
+    QCOMPARE(QByteArray(record.function), QByteArray("first()"));
+    QCOMPARE(record.text(), written[i].text());
+  }
+  QCOMPARE(written[1].text(), QStringLiteral("42 and argument"));
+  LogRecord end;
+  QVERIFY(!reader.read(&end));
+  QVERIFY(file.atEnd());
+}
+
+void TestLogging::text_percentArgument() {
+  // Placeholders inside arguments are text, not substituted again.
+  LogRecord record;
+  record.format = "%2 at %1: %3";
+  QDataStream stream(&record.arguments, QIODevice::WriteOnly);
+  stream.setVersion(QDataStream::Qt_5_12);
+  stream << QVariant(QStringLiteral("50%2")) << QVariant(QStringLiteral("%1"))
+         << QVariant(QStringLiteral("100%"));
+  QCOMPARE(record.text(), QStringLiteral("%1 at 50%2: 100%"));
+
+  // Placeholders without an argument are kept as they are.
+  record.format = "%1 %% %5 %9";
+  QCOMPARE(record.text(), QStringLiteral("50%2 %% %1 100%"));
+  record.format = "%1 and %4";
+  record.arguments.clear();
+  QCOMPARE(record.text(), QStringLiteral("%1 and %4"));
+}
+
+QTEST_GUILESS_MAIN(TestLogging)
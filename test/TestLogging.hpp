@@ -0,0 +1,23 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_LOGGING_HPP
+#define KTUTILS_TEST_LOGGING_HPP
+
+class TestLogging : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void cleanup();
+
+  void async_flush();
+  void async_temporaryContext();
+  void async_dropped();
+  void async_fatal();
+  void async_fatal_child();
+  void async_benchmark();
+
+  void binary_roundTrip();
+  void text_percentArgument();
+};
+
+#endif  // KTUTILS_TEST_LOGGING_HPP
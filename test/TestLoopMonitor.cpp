@@ -0,0 +1,89 @@
+﻿#include "TestLoopMonitor.hpp"
+#include <QtTest/QtTest>
+
+using namespace KtUtils;
+
+void TestLoopMonitor::stallDetected() {
+  LoopMonitor monitor;
+  monitor.setStallThreshold(50);
+  monitor.start();
+  QVERIFY(monitor.isActive());
+  QSignalSpy stalled(&monitor, &LoopMonitor::stallDetected);
+  QTimer::singleShot(10, &monitor, [] { QThread::msleep(100); });
+  QVERIFY(stalled.wait(1000));
+  QVERIFY(stalled.first().at(0).toDouble() >= 90);
+  QVERIFY(!stalled.first().at(2).toString().isEmpty());
+  QVERIFY(monitor.longestIteration() >= 90000000);
+  QVERIFY(monitor.iterationTime().count() > 0);
+  monitor.stop();
+  QVERIFY(!monitor.isActive());
+}
+
+void TestLoopMonitor::start_monitored() {
+  LoopMonitor monitor;
+  monitor.start();
+  // Only one monitor is active in a thread.
+  LoopMonitor second;
+  QTest::ignoreMessage(QtWarningMsg,
+                       "LoopMonitor::start: thread is already monitored");
+  second.start();
+  QVERIFY(!second.isActive());
+  monitor.stop();
+  second.start();
+  QVERIFY(second.isActive());
+}
+
+void TestLoopMonitor::stop_restart() {
+  QScopedPointer<LoopMonitor> monitor(new LoopMonitor);
+  monitor->start();
+  monitor.reset();
+  // State of destroyed monitor is released, next monitor starts.
+  QCoreApplication::processEvents();
+  LoopMonitor next;
+  next.start();
+  QVERIFY(next.isActive());
+}
+
+void TestLoopMonitor::destroy_otherThread() {
+  QThread thread;
+  QObject context;
+  context.moveToThread(&thread);
+  thread.start();
+
+  LoopMonitor* monitor = nullptr;
+  QMetaObject::invokeMethod(
+      &context,
+      [&monitor] {
+        monitor = new LoopMonitor;
+        monitor->start();
+      },
+      Qt::BlockingQueuedConnection);
+  QVERIFY(monitor->isActive());
+
+  QSemaphore blocked;
+  QSemaphore destroyed;
+  std::atomic<bool> restarted{false};
+  QMetaObject::invokeMethod(
+      &context,
+      [&] {
+        blocked.release();
+        destroyed.acquire();
+        // Next event of monitored thread releases state of the monitor.
+        QEvent event(QEvent::User);
+        QCoreApplication::sendEvent(&context, &event);
+        LoopMonitor next;
+        next.start();
+        restarted = next.isActive();
+      },
+      Qt::QueuedConnection);
+  // Destroyed in this thread while monitored thread is blocked.
+  blocked.acquire();
+  delete monitor;
+  destroyed.release();
+  QTRY_VERIFY(restarted);
+
+  thread.quit();
+  QVERIFY(thread.wait(1000));
+}
+
+QTEST_GUILESS_MAIN(TestLoopMonitor)
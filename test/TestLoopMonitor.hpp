@@ -0,0 +1,16 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_LOOPMONITOR_HPP
+#define KTUTILS_TEST_LOOPMONITOR_HPP
+
+class TestLoopMonitor : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void stallDetected();
+  void start_monitored();
+  void stop_restart();
+  void destroy_otherThread();
+};
+
+#endif  // KTUTILS_TEST_LOOPMONITOR_HPP
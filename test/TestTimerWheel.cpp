@@ -0,0 +1,219 @@
+﻿#include "TestTimerWheel.hpp"
+#include <random>
+#include <QtTest/QtTest>
+#include "TimerWheel_p.hpp"
+
+using namespace KtUtils;
+using TimerWheelExtra::Wheel;
+
+void TestTimerWheel::ticks_order() {
+  // Deadlines in all levels and beyond the range of the wheel.
+  std::mt19937_64 random(42);
+  std::vector<quint64> deadlines;
+  for (int i = 0; i < 500; ++i) {
+    deadlines.push_back(1 + random() % 64);
+    deadlines.push_back(1 + random() % 4096);
+    deadlines.push_back(1 + random() % 262144);
+    deadlines.push_back(1 + random() % 16777216);
+  }
+  for (int i = 0; i < 10; ++i) {
+    deadlines.push_back(16777216 + random() % 16777216);
+  }
+
+  Wheel wheel;
+  std::vector<quint64> fired;
+  for (const quint64 deadline : deadlines) {
+    wheel.add(deadline, [&wheel, &fired, deadline] {
+      QCOMPARE(wheel.current(), deadline);
+      fired.push_back(deadline);
+    });
+  }
+  QCOMPARE(wheel.count(), int(deadlines.size()));
+  wheel.advance(quint64(1) << 26);
+  QCOMPARE(wheel.count(), 0);
+  QCOMPARE(fired.size(), deadlines.size());
+  std::sort(deadlines.begin(), deadlines.end());
+  QVERIFY(fired == deadlines);
+}
+
+void TestTimerWheel::ticks_cascade() {
+  Wheel wheel;
+  quint64 firedAt = 0;
+  const Wheel::TimerId second = wheel.add(5000, [&] { firedAt = 5000; });
+  QCOMPARE(wheel.level(second), 2);
+  QCOMPARE(wheel.nextTick(), quint64(4096));
+  wheel.advance(4095);
+  QCOMPARE(wheel.level(second), 2);
+  // Cascaded from level 2 at start of its block, then from level 1.
+  wheel.advance(4096);
+  QCOMPARE(wheel.level(second), 1);
+  QCOMPARE(wheel.nextTick(), quint64(4992));
+  wheel.advance(4992);
+  QCOMPARE(wheel.level(second), 0);
+  wheel.advance(4999);
+  QVERIFY(wheel.isPending(second));
+  QCOMPARE(firedAt, quint64(0));
+  wheel.advance(5000);
+  QVERIFY(!wheel.isPending(second));
+  QCOMPARE(firedAt, quint64(5000));
+
+  // Level 3 cascades into level 2 first.
+  quint64 current = 0;
+  const Wheel::TimerId third =
+      wheel.add(300000, [&] { current = wheel.current(); });
+  QCOMPARE(wheel.level(third), 3);
+  wheel.advance(262143);
+  QCOMPARE(wheel.level(third), 3);
+  wheel.advance(262144);
+  QCOMPARE(wheel.level(third), 2);
+  wheel.advance(299999);
+  QCOMPARE(wheel.level(third), 0);
+  wheel.advance(1000000);
+  QCOMPARE(current, quint64(300000));
+  QCOMPARE(wheel.current(), quint64(1000000));
+  QCOMPARE(wheel.count(), 0);
+}
+
+void TestTimerWheel::ticks_parked() {
+  // Deadlines beyond the range are parked in level 3 and relinked.
+  Wheel wheel;
+  quint64 current = 0;
+  const quint64 deadline = TimerWheelExtra::kMaxTicks + 1000;
+  const Wheel::TimerId id =
+      wheel.add(deadline, [&] { current = wheel.current(); });
+  QCOMPARE(wheel.level(id), 3);
+  wheel.advance(deadline - 1);
+  QVERIFY(wheel.isPending(id));
+  QCOMPARE(wheel.level(id), 0);
+  wheel.advance(deadline);
+  QCOMPARE(current, deadline);
+
+  // Deadlines are at least the next tick.
+  const Wheel::TimerId late = wheel.add(0, [&] { current = 0; });
+  QCOMPARE(wheel.nextTick(), deadline + 1);
+  wheel.advance(deadline + 1);
+  QVERIFY(!wheel.isPending(late));
+  QCOMPARE(current, quint64(0));
+}
+
+void TestTimerWheel::ticks_cancel() {
+  Wheel wheel;
+  QStringList fired;
+  const Wheel::TimerId before =
+      wheel.add(5000, [&] { fired << QStringLiteral("before"); });
+  const Wheel::TimerId after =
+      wheel.add(5001, [&] { fired << QStringLiteral("after"); });
+  wheel.add(5002, [&] { fired << QStringLiteral("kept"); });
+  QCOMPARE(wheel.count(), 3);
+
+  // Canceled in level 2, before cascade.
+  QVERIFY(wheel.cancel(before));
+  QVERIFY(!wheel.isPending(before));
+  QVERIFY(!wheel.cancel(before));
+  QCOMPARE(wheel.count(), 2);
+
+  // Canceled in level 1, after cascade.
+  wheel.advance(4096);
+  QCOMPARE(wheel.level(after), 1);
+  QVERIFY(wheel.cancel(after));
+  QCOMPARE(wheel.level(after), TimerWheelExtra::kNil);
+  QCOMPARE(wheel.count(), 1);
+
+  wheel.advance(6000);
+  QCOMPARE(fired, QStringList{QStringLiteral("kept")});
+  QCOMPARE(wheel.count(), 0);
+}
+
+void TestTimerWheel::ticks_cancelUnknown() {
+  Wheel wheel;
+  QVERIFY(!wheel.cancel(0));
+  QVERIFY(!wheel.cancel(12345));
+  QVERIFY(!wheel.isPending(0));
+
+  // Id of an expired timer is unknown, even after its node is reused.
+  const Wheel::TimerId expired = wheel.add(1, [] {});
+  wheel.advance(1);
+  QVERIFY(!wheel.cancel(expired));
+  const Wheel::TimerId reused = wheel.add(10, [] {});
+  QVERIFY(reused != expired);
+  QCOMPARE(quint32(reused), quint32(expired));
+  QVERIFY(!wheel.cancel(expired));
+  QVERIFY(wheel.isPending(reused));
+  QCOMPARE(wheel.count(), 1);
+}
+
+void TestTimerWheel::schedule_order() {
+  TimerWheel wheel;
+  QElapsedTimer elapsed;
+  elapsed.start();
+  QVector<int> fired;
+  for (int i = 50; i > 0; --i) {
+    wheel.schedule(i * 2, [&fired, &elapsed, i] {
+      // Never expires earlier than requested.
+      QVERIFY(elapsed.elapsed() >= i * 2);
+      fired << i;
+    });
+  }
+  QCOMPARE(wheel.pendingCount(), 50);
+  QTRY_COMPARE(fired.size(), 50);
+  QVERIFY(std::is_sorted(fired.begin(), fired.end()));
+  QCOMPARE(wheel.pendingCount(), 0);
+}
+
+void TestTimerWheel::cancel_pending() {
+  TimerWheel wheel;
+  int fired = 0;
+  const TimerWheel::TimerId first = wheel.schedule(20, [&fired] { ++fired; });
+  const TimerWheel::TimerId second = wheel.schedule(
+      std::chrono::milliseconds(30), [&fired] { fired += 10; });
+  QCOMPARE(wheel.pendingCount(), 2);
+  QVERIFY(wheel.isPending(first));
+  QVERIFY(wheel.cancel(first));
+  QVERIFY(!wheel.isPending(first));
+  QVERIFY(!wheel.cancel(first));
+  QVERIFY(!wheel.cancel(0));
+  QCOMPARE(wheel.pendingCount(), 1);
+
+  QTRY_COMPARE(fired, 10);
+  QVERIFY(!wheel.isPending(second));
+  QVERIFY(!wheel.cancel(second));
+  QCOMPARE(wheel.pendingCount(), 0);
+
+  // Resolution only changes while no timer is pending.
+  wheel.setResolution(5);
+  QCOMPARE(wheel.resolution(), 5);
+  wheel.schedule(1000, [] {});
+  QTest::ignoreMessage(QtWarningMsg,
+                       "TimerWheel::setResolution: timers are pending");
+  wheel.setResolution(1);
+  QCOMPARE(wheel.resolution(), 5);
+}
+
+void TestTimerWheel::instance_threadExit() {
+  // Wheel of a thread is destroyed with it, pending callbacks are released
+  // without being invoked.
+  auto state = std::make_shared<int>(0);
+  std::weak_ptr<TimerWheel> handle;
+  bool sameWheel = false;
+  int pendingCount = 0;
+  QThread* thread = QThread::create([&, state] {
+    handle = TimerWheel::instanceHandle();
+    sameWheel = (handle.lock().get() == TimerWheel::instance());
+    TimerWheel::instance()->schedule(10000, [state] { *state = 1; });
+    pendingCount = TimerWheel::instance()->pendingCount();
+  });
+  thread->start();
+  QVERIFY(thread->wait(5000));
+  delete thread;
+  QVERIFY(sameWheel);
+  QCOMPARE(pendingCount, 1);
+  QVERIFY(handle.expired());
+  QCOMPARE(state.use_count(), long(1));
+  QCOMPARE(*state, 0);
+
+  // Wheel of this thread is another one.
+  QVERIFY(TimerWheel::instance());
+  QVERIFY(!TimerWheel::instanceHandle().expired());
+}
+
+QTEST_GUILESS_MAIN(TestTimerWheel)
@@ -0,0 +1,21 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_TIMERWHEEL_HPP
+#define KTUTILS_TEST_TIMERWHEEL_HPP
+
+class TestTimerWheel : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void ticks_order();
+  void ticks_cascade();
+  void ticks_parked();
+  void ticks_cancel();
+  void ticks_cancelUnknown();
+
+  void schedule_order();
+  void cancel_pending();
+  void instance_threadExit();
+};
+
+#endif  // KTUTILS_TEST_TIMERWHEEL_HPP
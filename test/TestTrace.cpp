@@ -0,0 +1,162 @@
+﻿#include "TestTrace.hpp"
+#include <QtTest/QtTest>
+
+using namespace KtUtils;
+
+// Complete events of given name, or of given thread if name is empty.
+static QList<QJsonObject> FindSpans(const QJsonObject& trace,
+                                    const QString& name, double tid = -1) {
+  QList<QJsonObject> ret;
+  for (const QJsonValue& value :
+       trace.value(QStringLiteral("traceEvents")).toArray()) {
+    const QJsonObject event = value.toObject();
+    if (event.value(QStringLiteral("ph")).toString() != QStringLiteral("X")) {
+      continue;
+    }
+    if (!name.isEmpty() &&
+        (event.value(QStringLiteral("name")).toString() != name)) {
+      continue;
+    }
+    if ((tid >= 0) && (event.value(QStringLiteral("tid")).toDouble() != tid)) {
+      continue;
+    }
+    ret << event;
+  }
+  return ret;
+}
+
+// Thread id of the thread_name event of given name, -1 if not found.
+static double FindThread(const QJsonObject& trace, const QString& name) {
+  for (const QJsonValue& value :
+       trace.value(QStringLiteral("traceEvents")).toArray()) {
+    const QJsonObject event = value.toObject();
+    if ((event.value(QStringLiteral("ph")).toString() == QStringLiteral("M")) &&
+        (event.value(QStringLiteral("args"))
+             .toObject()
+             .value(QStringLiteral("name"))
+             .toString() == name)) {
+      return event.value(QStringLiteral("tid")).toDouble();
+    }
+  }
+  return -1;
+}
+
+void TestTrace::init() {
+  Trace::setEnabled(true);
+  Trace::clear();
+}
+
+void TestTrace::span_record() {
+  {
+    TraceScope scope("TestTrace::span_record");
+    QThread::msleep(5);
+  }
+  Trace::setEnabled(false);
+  { TraceScope scope("TestTrace::span_disabled"); }
+  Trace::setEnabled(true);
+
+  const QJsonObject trace = Trace::toChromeTrace();
+  const QList<QJsonObject> spans =
+      FindSpans(trace, QStringLiteral("TestTrace::span_record"));
+  QCOMPARE(spans.size(), 1);
+  const QJsonObject& span = spans.first();
+  QCOMPARE(span.value(QStringLiteral("cat")).toString(),
+           QStringLiteral("KtUtils"));
+  // Microseconds.
+  QVERIFY(span.value(QStringLiteral("dur")).toDouble() >= 4000);
+  QCOMPARE(span.value(QStringLiteral("pid")).toDouble(),
+           double(QCoreApplication::applicationPid()));
+  QCOMPARE(span.value(QStringLiteral("tid")).toDouble(),
+           FindThread(trace, QStringLiteral("Main")));
+  QVERIFY(FindSpans(trace, QStringLiteral("TestTrace::span_disabled"))
+              .isEmpty());
+}
+
+void TestTrace::span_wrap() {
+  static const char* const kNames[] = {"span0", "span1", "span2", "span3",
+                                       "span4", "span5", "span6"};
+  const int capacity = Trace::bufferCapacity();
+  // Applies to buffer of the new thread.
+  Trace::setBufferCapacity(4);
+  QThread* thread = QThread::create([] {
+    for (const char* name : kNames) {
+      TraceScope scope(name);
+    }
+  });
+  thread->setObjectName(QStringLiteral("TestTrace::span_wrap"));
+  thread->start();
+  QVERIFY(thread->wait(1000));
+  delete thread;
+  Trace::setBufferCapacity(capacity);
+
+  // Latest spans are kept, oldest first.
+  const QJsonObject trace = Trace::toChromeTrace();
+  const double tid = FindThread(trace, QStringLiteral("TestTrace::span_wrap"));
+  QVERIFY(tid >= 0);
+  QStringList names;
+  double last = -1;
+  for (const QJsonObject& span : FindSpans(trace, QString(), tid)) {
+    names << span.value(QStringLiteral("name")).toString();
+    QVERIFY(span.value(QStringLiteral("ts")).toDouble() >= last);
+    last = span.value(QStringLiteral("ts")).toDouble();
+  }
+  QCOMPARE(names, (QStringList{QStringLiteral("span3"), QStringLiteral("span4"),
+                               QStringLiteral("span5"),
+                               QStringLiteral("span6")}));
+
+  // Buffer of exited thread is dropped.
+  Trace::clear();
+  QCOMPARE(FindThread(Trace::toChromeTrace(),
+                      QStringLiteral("TestTrace::span_wrap")),
+           -1.0);
+}
+
+void TestTrace::span_wait() {
+  WaitTrace::setEnabled(true);
+  WaitTrace::reset();
+  {
+    TraceScope scope("TestTrace::span_wait");
+    ::WaitFor(10);
+  }
+  WaitTrace::setEnabled(false);
+
+  // Waits are measured by the same clock, inside the enclosing span.
+  const QList<QJsonObject> outer = FindSpans(
+      Trace::toChromeTrace(), QStringLiteral("TestTrace::span_wait"));
+  const QList<QJsonObject> waits =
+      FindSpans(WaitTrace::toChromeTrace(), QString());
+  QCOMPARE(outer.size(), 1);
+  QCOMPARE(waits.size(), 1);
+  const double start = outer.first().value(QStringLiteral("ts")).toDouble();
+  const double end =
+      start + outer.first().value(QStringLiteral("dur")).toDouble();
+  const double waitStart = waits.first().value(QStringLiteral("ts")).toDouble();
+  const double waitEnd =
+      waitStart + waits.first().value(QStringLiteral("dur")).toDouble();
+  QCOMPARE(waits.first().value(QStringLiteral("cat")).toString(),
+           QStringLiteral("wait"));
+  QVERIFY(waitStart >= start);
+  QVERIFY(waitEnd <= end);
+  QVERIFY(waitEnd - waitStart >= 9000);
+}
+
+void TestTrace::writeChromeTrace() {
+  { TraceScope scope("TestTrace::writeChromeTrace"); }
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString path = dir.filePath(QStringLiteral("trace.json"));
+  QVERIFY(Trace::writeChromeTrace(path));
+
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  QJsonParseError error;
+  const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+  QCOMPARE(error.error, QJsonParseError::NoError);
+  QCOMPARE(doc.object(), Trace::toChromeTrace());
+
+  QTest::ignoreMessage(QtWarningMsg,
+                       QRegularExpression("Trace::writeChromeTrace: .*"));
+  QVERIFY(!Trace::writeChromeTrace(dir.filePath(QStringLiteral("a/b.json"))));
+}
+
+QTEST_GUILESS_MAIN(TestTrace)
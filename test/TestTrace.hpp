@@ -0,0 +1,18 @@
+﻿#pragma once
+#ifndef KTUTILS_TEST_TRACE_HPP
+#define KTUTILS_TEST_TRACE_HPP
+
+class TestTrace : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void init();
+
+  void span_record();
+  void span_wrap();
+  void span_wait();
+  void writeChromeTrace();
+};
+
+#endif  // KTUTILS_TEST_TRACE_HPP
@@ -0,0 +1,58 @@
+#include <KtUtils/Logging>
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName(QStringLiteral("KtLogDecode"));
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      QStringLiteral("Convert logs written by KtUtils::BinaryLogSink into "
+                     "text."));
+  parser.addHelpOption();
+  parser.addPositionalArgument(QStringLiteral("input"),
+                               QStringLiteral("Binary log file."));
+  const QCommandLineOption outputOption(
+      {QStringLiteral("o"), QStringLiteral("output")},
+      QStringLiteral("Write text into <file> instead of stdout."),
+      QStringLiteral("file"));
+  parser.addOption(outputOption);
+  parser.process(app);
+
+  const QStringList inputs = parser.positionalArguments();
+  if (inputs.size() != 1) parser.showHelp(EXIT_FAILURE);
+
+  QFile input(inputs.first());
+  if (!input.open(QIODevice::ReadOnly)) {
+    qCritical().noquote() << "Failed to open" << input.fileName() << ":"
+                          << input.errorString();
+    return EXIT_FAILURE;
+  }
+  QFile output;
+  bool opened = false;
+  if (parser.isSet(outputOption)) {
+    output.setFileName(parser.value(outputOption));
+    opened = output.open(QIODevice::WriteOnly | QIODevice::Truncate |
+                         QIODevice::Text);
+  } else {
+    opened = output.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+  }
+  if (!opened) {
+    qCritical().noquote() << "Failed to open output:" << output.errorString();
+    return EXIT_FAILURE;
+  }
+
+  KtUtils::BinaryLogReader reader(&input);
+  if (!reader.isValid()) {
+    qCritical().noquote() << input.fileName() << "is not a binary log";
+    return EXIT_FAILURE;
+  }
+  KtUtils::LogRecord record;
+  while (reader.read(&record)) {
+    output.write(KtUtils::LogSink::format(record).toUtf8());
+    output.write("\n", 1);
+  }
+  if (!input.atEnd()) {
+    qWarning().noquote() << input.fileName() << "is truncated or corrupted";
+  }
+  return EXIT_SUCCESS;
+}